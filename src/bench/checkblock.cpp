@@ -8,6 +8,9 @@
 #include <validation.h>
 #include <streams.h>
 #include <consensus/validation.h>
+#include <util.h>
+
+#include <boost/thread/thread.hpp>
 
 namespace block_bench {
 #include <bench/data/block413567.raw.h>
@@ -35,7 +38,9 @@ static void DeserializeBlockTest(benchmark::State& state)
     }
 }
 
-static void DeserializeAndCheckBlockTest(benchmark::State& state)
+// CheckBlock hands the transaction checks of large blocks to the block check
+// threads, which are started as for -par=0 unless nThreads says otherwise.
+static void DeserializeAndCheckBlock(benchmark::State& state, int nThreads)
 {
     CDataStream stream((const char*)block_bench::block413567,
             (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
@@ -45,6 +50,11 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
 
     const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
 
+    nBlockCheckThreads = nThreads > 1 ? nThreads : 0;
+    boost::thread_group threadGroup;
+    for (int i = 0; i < nBlockCheckThreads - 1; i++)
+        threadGroup.create_thread(&ThreadBlockCheck);
+
     while (state.KeepRunning()) {
         CBlock block; // Note that CBlock caches its checked state, so we need to recreate it here
         stream >> block;
@@ -53,7 +63,15 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
         CValidationState validationState;
         assert(CheckBlock(block, validationState, chainParams->GetConsensus()));
     }
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    nBlockCheckThreads = 0;
 }
 
+static void DeserializeAndCheckBlockTest(benchmark::State& state) { DeserializeAndCheckBlock(state, std::min(GetNumCores(), MAX_SCRIPTCHECK_THREADS)); }
+static void DeserializeAndCheckBlockTestSingleThread(benchmark::State& state) { DeserializeAndCheckBlock(state, 1); }
+
 BENCHMARK(DeserializeBlockTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(DeserializeAndCheckBlockTestSingleThread, 160);
@@ -0,0 +1,177 @@
+// Copyright (c) 2018 the Kevacoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <rpc/mining.h>
+#include <script/script.h>
+#include <streams.h>
+
+#include <cnutils.h>
+#include <cryptonote_core/cryptonote_tx_utils.h>
+
+#include <assert.h>
+
+// The pool facing side of mining: building the Cryptonote template blob that
+// getblocktemplate serves, turning it into the blob miners hash as pools do
+// with convert_blob, and parsing it back in submitblock. Full templates embed
+// the whole kevacoin block in the miner tx, so their cost grows with the
+// number of mempool transactions that made it into the block; compact
+// templates only embed the header. Blobs of a served template take the fast
+// path, which compares them with the template. The PoW hashes themselves are in
+// pow_hash.cpp.
+
+/** A block as BlockAssembler would build it from a mempool of nTx simple payments. */
+static CBlock CreateTemplateBlock(const Consensus::Params& consensusParams, int nTx)
+{
+    CBlock block;
+    block.nVersion = 0x20000000;
+    block.hashPrevBlock = uint256S("0x8e5f0ad5bb46e8e2dbe2c70f6ff8ff5a2c3e0c58cbd18b21d4d3e1f2b6b0e7a1");
+    block.nTime = 1541548800;
+    block.nBits = 0x1e0fffff;
+    // The nonce is the height, which selects the CN major version.
+    block.nNonce = consensusParams.RandomXHeight + 1000;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << block.nNonce << OP_0;
+    coinbase.vout.resize(1);
+    coinbase.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x11) << OP_EQUALVERIFY << OP_CHECKSIG;
+    coinbase.vout[0].nValue = 50 * COIN;
+    block.vtx.push_back(MakeTransactionRef(std::move(coinbase)));
+
+    for (int i = 0; i < nTx; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(2);
+        for (size_t j = 0; j < tx.vin.size(); j++) {
+            tx.vin[j].prevout = COutPoint(ArithToUint256(arith_uint256(i * 2 + j + 1)), j);
+            // Sized like a P2PKH signature and public key.
+            tx.vin[j].scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+        }
+        tx.vout.resize(2);
+        for (size_t j = 0; j < tx.vout.size(); j++) {
+            tx.vout[j].scriptPubKey = CScript() << OP_HASH160 << std::vector<unsigned char>(20, (unsigned char)(i + j)) << OP_EQUAL;
+            tx.vout[j].nValue = COIN;
+        }
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    return block;
+}
+
+static const int RESERVE_SIZE = 8;
+
+static void CNMinerTx(benchmark::State& state)
+{
+    cryptonote::address_parse_info info;
+    const bool fParsed = cryptonote::get_account_address_from_str(info, cryptonote::MAINNET, CN_DUMMY_ADDRESS);
+    assert(fParsed);
+    cryptonote::blobdata extra_nonce(RESERVE_SIZE, 0);
+    while (state.KeepRunning()) {
+        cryptonote::transaction miner_tx;
+        const bool fConstructed = cryptonote::construct_miner_tx(10000, 20000, 10000, 20000, 0, info.address, miner_tx, extra_nonce, 10);
+        assert(fConstructed);
+    }
+}
+
+static void CNBuildTemplate(benchmark::State& state, int nTx, bool fCompact)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const Consensus::Params& consensusParams = chainParams->GetConsensus();
+    const CBlock block = CreateTemplateBlock(consensusParams, nTx);
+    while (state.KeepRunning()) {
+        CNBlockTemplate tmpl;
+        tmpl.block = block;
+        BuildCNBlockBlob(tmpl, consensusParams, RESERVE_SIZE, fCompact);
+    }
+}
+
+static void CNConvertBlob(benchmark::State& state, int nTx)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    CNBlockTemplate tmpl;
+    tmpl.block = CreateTemplateBlock(chainParams->GetConsensus(), nTx);
+    BuildCNBlockBlob(tmpl, chainParams->GetConsensus(), RESERVE_SIZE, false);
+    char hashingBlob[CN_HEADER_MAX_BLOB_SIZE];
+    while (state.KeepRunning()) {
+        const int nSize = convert_blob(tmpl.blob.data(), tmpl.blob.size(), hashingBlob);
+        assert(nSize > 0);
+    }
+}
+
+static void CNSubmitBlob(benchmark::State& state, int nTx, bool fCompact)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    CNBlockTemplate tmpl;
+    tmpl.block = CreateTemplateBlock(chainParams->GetConsensus(), nTx);
+    BuildCNBlockBlob(tmpl, chainParams->GetConsensus(), RESERVE_SIZE, fCompact);
+    CDataStream ssBody(SER_NETWORK, PROTOCOL_VERSION);
+    ssBody << tmpl.block.vtx;
+    const std::vector<unsigned char> body(ssBody.begin(), ssBody.end());
+    while (state.KeepRunning()) {
+        CBlock block;
+        DecodeCNBlockBlob(tmpl.blob, fCompact ? &body : nullptr, block);
+        assert(block.vtx.size() == (size_t)nTx + 1);
+    }
+}
+
+/** submitblock for blobs of a served template, which are matched against it instead of parsed. */
+static void CNSubmitBlobFast(benchmark::State& state, int nTx, bool fCompact)
+{
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    CNBlockTemplate tmpl;
+    tmpl.block = CreateTemplateBlock(chainParams->GetConsensus(), nTx);
+    BuildCNBlockBlob(tmpl, chainParams->GetConsensus(), RESERVE_SIZE, fCompact);
+    assert(tmpl.fFastSubmit);
+    // A miner fills in the nonce and the reserved bytes.
+    std::string blob = tmpl.blob;
+    blob[tmpl.nPrevIdOffset + 32] = 0x5a;
+    blob[tmpl.nReservedOffset] = 0x01;
+    while (state.KeepRunning()) {
+        CBlock block;
+        const bool fMatched = GetBlockFromCNTemplate(tmpl, tmpl.block.nTime, tmpl.block.nBits, blob, block);
+        assert(fMatched);
+    }
+}
+
+static void CNBuildTemplateEmpty(benchmark::State& state) { CNBuildTemplate(state, 0, false); }
+static void CNBuildTemplate100Tx(benchmark::State& state) { CNBuildTemplate(state, 100, false); }
+static void CNBuildTemplate1000Tx(benchmark::State& state) { CNBuildTemplate(state, 1000, false); }
+static void CNBuildTemplate4000Tx(benchmark::State& state) { CNBuildTemplate(state, 4000, false); }
+static void CNBuildTemplate4000TxCompact(benchmark::State& state) { CNBuildTemplate(state, 4000, true); }
+
+static void CNConvertBlobEmpty(benchmark::State& state) { CNConvertBlob(state, 0); }
+static void CNConvertBlob4000Tx(benchmark::State& state) { CNConvertBlob(state, 4000); }
+
+static void CNSubmitBlobEmpty(benchmark::State& state) { CNSubmitBlob(state, 0, false); }
+static void CNSubmitBlob100Tx(benchmark::State& state) { CNSubmitBlob(state, 100, false); }
+static void CNSubmitBlob1000Tx(benchmark::State& state) { CNSubmitBlob(state, 1000, false); }
+static void CNSubmitBlob4000Tx(benchmark::State& state) { CNSubmitBlob(state, 4000, false); }
+static void CNSubmitBlob4000TxCompact(benchmark::State& state) { CNSubmitBlob(state, 4000, true); }
+static void CNSubmitBlobFastEmpty(benchmark::State& state) { CNSubmitBlobFast(state, 0, false); }
+static void CNSubmitBlobFast4000Tx(benchmark::State& state) { CNSubmitBlobFast(state, 4000, false); }
+static void CNSubmitBlobFast4000TxCompact(benchmark::State& state) { CNSubmitBlobFast(state, 4000, true); }
+
+BENCHMARK(CNMinerTx, 2000);
+BENCHMARK(CNBuildTemplateEmpty, 2000);
+BENCHMARK(CNBuildTemplate100Tx, 500);
+BENCHMARK(CNBuildTemplate1000Tx, 50);
+BENCHMARK(CNBuildTemplate4000Tx, 10);
+BENCHMARK(CNBuildTemplate4000TxCompact, 2000);
+BENCHMARK(CNConvertBlobEmpty, 20000);
+BENCHMARK(CNConvertBlob4000Tx, 50);
+BENCHMARK(CNSubmitBlobEmpty, 20000);
+BENCHMARK(CNSubmitBlob100Tx, 1000);
+BENCHMARK(CNSubmitBlob1000Tx, 100);
+BENCHMARK(CNSubmitBlob4000Tx, 20);
+BENCHMARK(CNSubmitBlob4000TxCompact, 20);
+BENCHMARK(CNSubmitBlobFastEmpty, 20000);
+BENCHMARK(CNSubmitBlobFast4000Tx, 200);
+BENCHMARK(CNSubmitBlobFast4000TxCompact, 200);
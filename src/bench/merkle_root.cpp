@@ -0,0 +1,32 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <consensus/merkle.h>
+#include <random.h>
+#include <uint256.h>
+
+// The merkle root of a block the size of the one in checkblock.cpp, and of a
+// large one. Each level of the tree is hashed with SHA256D64, so these follow
+// the SHA256D64_* benchmarks in crypto_hash.cpp.
+static void MerkleRootLeaves(benchmark::State& state, size_t nLeaves)
+{
+    FastRandomContext rng(true);
+    std::vector<uint256> leaves(nLeaves);
+    for (auto& item : leaves) {
+        item = rng.rand256();
+    }
+    while (state.KeepRunning()) {
+        bool mutation = false;
+        uint256 hash = ComputeMerkleRoot(std::vector<uint256>(leaves), &mutation);
+        leaves[mutation] = hash;
+    }
+}
+
+static void MerkleRoot(benchmark::State& state) { MerkleRootLeaves(state, 3808); }
+static void MerkleRoot9001(benchmark::State& state) { MerkleRootLeaves(state, 9001); }
+
+BENCHMARK(MerkleRoot, 1600);
+BENCHMARK(MerkleRoot9001, 800);
@@ -0,0 +1,65 @@
+// Copyright (c) 2018 the Kevacoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <primitives/block.h>
+
+#include <string.h>
+
+// One PoW hash per iteration for every block version the chain has used:
+// Cryptonight variants 0 to 4 (major versions 6 to 10) and RandomX. The
+// Cryptonight cases run on the path the node picks for this CPU, and again
+// with that path turned off to show what it is worth.
+
+static void CryptonightHash(benchmark::State& state, int variant, bool fSoftwareAES, bool fJIT)
+{
+    crypto::cn_slow_hash_set_software_aes(fSoftwareAES);
+    crypto::cn_slow_hash_set_v4_jit(fJIT);
+    unsigned char blob[76];
+    memset(blob, 0x4b, sizeof(blob));
+    uint64_t height = 100000;
+    char hash[crypto::HASH_SIZE];
+    while (state.KeepRunning()) {
+        // CryptonightR programs are derived from the height.
+        crypto::cn_slow_hash(blob, sizeof(blob), hash, variant, 0, height++);
+    }
+    crypto::cn_slow_hash_set_software_aes(false);
+    crypto::cn_slow_hash_set_v4_jit(true);
+}
+
+static void CryptonightV0(benchmark::State& state) { CryptonightHash(state, 0, false, true); }
+static void CryptonightV1(benchmark::State& state) { CryptonightHash(state, 1, false, true); }
+static void CryptonightV2(benchmark::State& state) { CryptonightHash(state, 2, false, true); }
+static void CryptonightV3(benchmark::State& state) { CryptonightHash(state, 3, false, true); }
+static void CryptonightV4(benchmark::State& state) { CryptonightHash(state, 4, false, true); }
+static void CryptonightV2SoftwareAES(benchmark::State& state) { CryptonightHash(state, 2, true, true); }
+static void CryptonightV4SoftwareAES(benchmark::State& state) { CryptonightHash(state, 4, true, true); }
+static void CryptonightV4Interpreted(benchmark::State& state) { CryptonightHash(state, 4, false, false); }
+
+static void RandomXLight(benchmark::State& state)
+{
+    unsigned char blob[76];
+    memset(blob, 0x4b, sizeof(blob));
+    char seed_hash[crypto::HASH_SIZE];
+    memset(seed_hash, 0x5a, sizeof(seed_hash));
+    const uint64_t height = 4096;
+    uint32_t nonce = 0;
+    char hash[crypto::HASH_SIZE];
+    while (state.KeepRunning()) {
+        memcpy(blob + 39, &nonce, sizeof(nonce));
+        nonce++;
+        crypto::rx_slow_hash(height, crypto::rx_seedheight(height), seed_hash, blob, sizeof(blob), hash, 0, 0);
+    }
+}
+
+BENCHMARK(CryptonightV0, 500);
+BENCHMARK(CryptonightV1, 500);
+BENCHMARK(CryptonightV2, 500);
+BENCHMARK(CryptonightV3, 500);
+BENCHMARK(CryptonightV4, 500);
+BENCHMARK(CryptonightV2SoftwareAES, 100);
+BENCHMARK(CryptonightV4SoftwareAES, 100);
+BENCHMARK(CryptonightV4Interpreted, 200);
+BENCHMARK(RandomXLight, 50);
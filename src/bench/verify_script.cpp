@@ -7,8 +7,10 @@
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
+#include <script/keva.h>
 #include <script/script.h>
 #include <script/sign.h>
+#include <script/standard.h>
 #include <streams.h>
 
 #include <array>
@@ -105,4 +107,76 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+// Keva updates spent one after another, as in a block full of them. With a
+// single signer its parsed public key is cached after the first one; with
+// many it mostly has to be parsed again. The updates pay to P2PKH or to
+// P2SH-P2WPKH addresses, and are checked either by VerifyScript, which
+// recognizes these templates, or by the interpreter.
+static void VerifyKevaPutBench(benchmark::State& state, size_t nSigners, bool fWitness, bool fInterpreted)
+{
+    const int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC | (fWitness ? SCRIPT_VERIFY_WITNESS : 0);
+    const size_t nSpends = 2048;
+    const auto verify = fInterpreted ? VerifyScriptInterpreted : VerifyScript;
+
+    std::vector<CKey> keys(nSigners);
+    for (size_t i = 0; i < nSigners; i++) {
+        std::array<unsigned char, 32> vchKey{};
+        vchKey[30] = (i + 1) >> 8;
+        vchKey[31] = (i + 1) & 0xff;
+        keys[i].Set(vchKey.begin(), vchKey.end(), true);
+    }
+
+    const valtype nameSpace(20, 'n');
+    const valtype value(100, 'v');
+    std::vector<CTransaction> vCredit;
+    std::vector<CMutableTransaction> vSpend;
+    for (size_t i = 0; i < nSpends; i++) {
+        const CKey& key = keys[i % nSigners];
+        const CPubKey pubkey = key.GetPubKey();
+        const CScript scriptCode = CScript() << OP_DUP << OP_HASH160 << ToByteVector(pubkey.GetID()) << OP_EQUALVERIFY << OP_CHECKSIG;
+        const CScript redeemScript = CScript() << OP_0 << ToByteVector(pubkey.GetID());
+        const CScript scriptAddr = fWitness ? GetScriptForDestination(CScriptID(redeemScript)) : scriptCode;
+        const valtype kevaKey(1, (unsigned char)i);
+        vCredit.emplace_back(BuildCreditingTransaction(CKevaScript::buildKevaPut(scriptAddr, nameSpace, kevaKey, value)));
+        vSpend.push_back(BuildSpendingTransaction(CScript(), vCredit.back()));
+        std::vector<unsigned char> vchSig;
+        if (fWitness) {
+            key.Sign(SignatureHash(scriptCode, vSpend.back(), 0, SIGHASH_ALL, vCredit.back().vout[0].nValue, SIGVERSION_WITNESS_V0), vchSig);
+            vchSig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+            vSpend.back().vin[0].scriptSig = CScript() << ToByteVector(redeemScript);
+            vSpend.back().vin[0].scriptWitness.stack = {vchSig, ToByteVector(pubkey)};
+        } else {
+            key.Sign(SignatureHash(vCredit.back().vout[0].scriptPubKey, vSpend.back(), 0, SIGHASH_ALL, vCredit.back().vout[0].nValue, SIGVERSION_BASE), vchSig);
+            vchSig.push_back(static_cast<unsigned char>(SIGHASH_ALL));
+            vSpend.back().vin[0].scriptSig = CScript() << vchSig << ToByteVector(pubkey);
+        }
+    }
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        ScriptError err;
+        bool success = verify(
+            vSpend[i].vin[0].scriptSig,
+            vCredit[i].vout[0].scriptPubKey,
+            &vSpend[i].vin[0].scriptWitness,
+            flags,
+            MutableTransactionSignatureChecker(&vSpend[i], 0, vCredit[i].vout[0].nValue),
+            &err);
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+        i = (i + 1) % nSpends;
+    }
+}
+
+static void VerifyKevaPutSameSigner(benchmark::State& state) { VerifyKevaPutBench(state, 1, false, false); }
+static void VerifyKevaPutDistinctSigners(benchmark::State& state) { VerifyKevaPutBench(state, 2048, false, false); }
+static void VerifyKevaPutInterpreted(benchmark::State& state) { VerifyKevaPutBench(state, 1, false, true); }
+static void VerifyKevaPutP2SHP2WPKH(benchmark::State& state) { VerifyKevaPutBench(state, 1, true, false); }
+static void VerifyKevaPutP2SHP2WPKHInterpreted(benchmark::State& state) { VerifyKevaPutBench(state, 1, true, true); }
+
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(VerifyKevaPutSameSigner, 6300);
+BENCHMARK(VerifyKevaPutDistinctSigners, 6300);
+BENCHMARK(VerifyKevaPutInterpreted, 6300);
+BENCHMARK(VerifyKevaPutP2SHP2WPKH, 6300);
+BENCHMARK(VerifyKevaPutP2SHP2WPKHInterpreted, 6300);
@@ -17,6 +17,7 @@
 #include <primitives/transaction.h>
 #include <script/script.h>
 #include <script/sign.h>
+#include <seedheightindex.h>
 #include <univalue.h>
 #include <util.h>
 #include <utilmoneystr.h>
@@ -31,11 +32,11 @@ static bool fCreateBlank;
 static std::map<std::string,UniValue> registers;
 static const int CONTINUE_EXECUTION=-1;
 
-// To fix the chainActive not defined error.
-CChain chainActive;
-typedef std::map<uint64_t, CBlockIndex*> BlockSeedHeightMap;
+// primitives/block.cpp looks up RandomX seed blocks here; bitcoin-tx has no
+// block index, so it stays empty.
 CCriticalSection cs_main;
-BlockSeedHeightMap mapBlockSeedHeight;
+static CSeedHeightIndex seedHeightIndexEmpty;
+CSeedHeightIndex& seedHeightIndex = seedHeightIndexEmpty;
 
 //
 // This function returns either one of EXIT_ codes when it's expected to stop the process or
@@ -160,6 +160,8 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    BLOCK_POW_ASSUMED       =   256, //!< header accepted below the -assumevalidpow checkpoint before it was known, PoW not checked
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -213,8 +215,15 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
-    //! Cryptonote header
-    CryptoNoteHeader cnHeader;
+    //! Cryptonote header, without prev_id. For every indexed block prev_id is
+    //! the original block hash of the fields above (see isCNConsistent), so it
+    //! is derived on demand instead of being stored twice.
+    uint64_t nCNTimestamp;
+    uint64_t nCNTxes;
+    uint256 hashCNMerkleRoot;
+    uint32_t nCNNonce;
+    uint8_t nCNMajorVersion;
+    uint8_t nCNMinorVersion;
 
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     int32_t nSequenceId;
@@ -243,7 +252,7 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
-        cnHeader.SetNull();
+        SetCNHeader(CryptoNoteHeader());
     }
 
     CBlockIndex()
@@ -260,7 +269,31 @@ public:
         nTime          = block.nTime;
         nBits          = block.nBits;
         nNonce         = block.nNonce;
-        cnHeader       = block.cnHeader;
+        SetCNHeader(block.cnHeader);
+    }
+
+    void SetCNHeader(const CryptoNoteHeader& cnHeader)
+    {
+        nCNMajorVersion  = cnHeader.major_version;
+        nCNMinorVersion  = cnHeader.minor_version;
+        nCNTimestamp     = cnHeader.timestamp;
+        nCNNonce         = cnHeader.nonce;
+        hashCNMerkleRoot = cnHeader.merkle_root;
+        nCNTxes          = cnHeader.nTxes;
+    }
+
+    //! Rebuild the full Cryptonote header, given the original block hash.
+    CryptoNoteHeader GetCNHeader(const uint256& hashOriginalBlock) const
+    {
+        CryptoNoteHeader cnHeader;
+        cnHeader.major_version = nCNMajorVersion;
+        cnHeader.minor_version = nCNMinorVersion;
+        cnHeader.timestamp     = nCNTimestamp;
+        cnHeader.prev_id       = hashOriginalBlock;
+        cnHeader.nonce         = nCNNonce;
+        cnHeader.merkle_root   = hashCNMerkleRoot;
+        cnHeader.nTxes         = nCNTxes;
+        return cnHeader;
     }
 
     CDiskBlockPos GetBlockPos() const {
@@ -291,7 +324,10 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.cnHeader       = cnHeader;
+        block.cnHeader       = GetCNHeader(block.GetOriginalBlockHash());
+        if (phashBlock) {
+            block.SetKnownHash(*phashBlock);
+        }
         return block;
     }
 
@@ -382,6 +418,8 @@ class CDiskBlockIndex : public CBlockIndex
 {
 public:
     uint256 hashPrev;
+    //! prev_id of the Cryptonote header as read; the index derives it from the other fields
+    uint256 hashCNPrevId;
 
     CDiskBlockIndex() {
         hashPrev = uint256();
@@ -416,10 +454,18 @@ public:
         READWRITE(nTime);
         READWRITE(nBits);
         READWRITE(nNonce);
+        CryptoNoteHeader cnHeader;
+        if (!ser_action.ForRead()) {
+            cnHeader = GetBlockHeader().cnHeader;
+        }
         READWRITE(cnHeader);
+        if (ser_action.ForRead()) {
+            SetCNHeader(cnHeader);
+            hashCNPrevId = cnHeader.prev_id;
+        }
     }
 
-    uint256 GetBlockHash() const
+    CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
         block.nVersion        = nVersion;
@@ -428,8 +474,13 @@ public:
         block.nTime           = nTime;
         block.nBits           = nBits;
         block.nNonce          = nNonce;
-        block.cnHeader        = cnHeader;
-        return block.GetHash();
+        block.cnHeader        = GetCNHeader(block.GetOriginalBlockHash());
+        return block;
+    }
+
+    uint256 GetBlockHash() const
+    {
+        return GetBlockHeader().GetHash();
     }
 
 
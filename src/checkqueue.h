@@ -8,6 +8,7 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -25,12 +26,31 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker has its own queue, which the master fills round robin.
+  * Workers take from the back of their own queue and steal from the front
+  * of the others' once it is empty, so they only meet on a shared lock
+  * when they run out of work.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! The checks queued for one worker.
+    struct WorkerQueue
+    {
+        boost::mutex mutex;
+        //! Checks in [nHead, checks.size()) are queued; the ones before were stolen.
+        std::vector<T> checks;
+        size_t nHead = 0;
+        //! Number of queued checks, read without the lock to skip empty queues.
+        std::atomic<size_t> nSize{0};
+    };
+
+    //! Upper bound on the number of worker queues; further workers share them.
+    static const unsigned int MAX_QUEUES = 128;
+
+    //! Mutex for idle workers and the master to wait on, and for waking them
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,87 +59,121 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The master's queue comes first, then one per worker thread.
+    WorkerQueue queues[MAX_QUEUES];
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! The number of worker threads, not counting the master.
+    std::atomic<unsigned int> nWorkers;
 
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The queue the next batch is added to. Only used by the master.
+    unsigned int nNextQueue;
 
-    //! The temporary evaluation result.
-    bool fAllOk;
+    //! Checks sitting in the queues. Briefly negative while an added batch
+    //! is taken before it is counted.
+    std::atomic<int> nQueued;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! The temporary evaluation result.
+    std::atomic<bool> fAllOk;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    unsigned int NumQueues() const
+    {
+        return std::min(nWorkers.load() + 1, MAX_QUEUES);
+    }
+
+    /**
+     * Move checks from q into vChecks: from the back if this is the
+     * worker's own queue, from the front if it is stolen. Takes half of
+     * what is queued, so that others can still steal the rest, but no more
+     * than nBatchSize. Returns the number of checks taken.
+     */
+    unsigned int Take(WorkerQueue& q, std::vector<T>& vChecks, bool fOwn)
+    {
+        if (q.nSize.load(std::memory_order_relaxed) == 0) {
+            return 0;
+        }
+        boost::unique_lock<boost::mutex> lock(q.mutex);
+        const size_t nAvail = q.checks.size() - q.nHead;
+        if (nAvail == 0) {
+            return 0;
+        }
+        const unsigned int nNow = std::max<size_t>(1, std::min<size_t>(nBatchSize, nAvail / 2));
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // Swap instead of copy, as in Add.
+            if (fOwn) {
+                vChecks[i].swap(q.checks.back());
+                q.checks.pop_back();
+            } else {
+                vChecks[i].swap(q.checks[q.nHead++]);
+            }
+        }
+        if (q.nHead == q.checks.size()) {
+            q.checks.clear();
+            q.nHead = 0;
+        }
+        q.nSize = q.checks.size() - q.nHead;
+        return nNow;
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        unsigned int nSelf = 0;
+        if (!fMaster) {
+            nSelf = 1 + nWorkers++ % (MAX_QUEUES - 1);
+        }
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
+            unsigned int nNow = Take(queues[nSelf], vChecks, true);
+            const unsigned int nQueues = NumQueues();
+            for (unsigned int i = 1; nNow == 0 && i < nQueues; i++) {
+                nNow = Take(queues[(nSelf + i) % nQueues], vChecks, false);
+            }
+            if (nNow) {
+                nQueued -= nNow;
+                // Check whether we need to do work at all
+                bool fOk = fAllOk;
+                // execute work
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+                vChecks.clear();
+                if (!fOk) {
+                    fAllOk = false;
+                }
+                if ((nTodo -= nNow) == 0 && !fMaster) {
+                    // We processed the last element; inform the master it can exit and return the result
+                    boost::unique_lock<boost::mutex> lock(mutex);
+                    condMaster.notify_one();
                 }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster) {
+                while (nTodo != 0 && nQueued <= 0) {
+                    condMaster.wait(lock);
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
+                if (nTodo == 0) {
+                    // return the current status, and reset it for new work later
+                    return fAllOk.exchange(true);
+                }
+            } else {
+                while (nQueued <= 0) {
+                    condWorker.wait(lock); // wait
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
         } while (true);
     }
 
@@ -128,7 +182,7 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    explicit CCheckQueue(unsigned int nBatchSizeIn) : nWorkers(0), nNextQueue(0), nQueued(0), nTodo(0), fAllOk(true), nBatchSize(nBatchSizeIn) {}
 
     //! Worker thread
     void Thread()
@@ -145,15 +199,28 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty()) {
+            return;
         }
         nTodo += vChecks.size();
+        // Spread large batches over several queues.
+        const unsigned int nQueues = NumQueues();
+        const size_t nChunk = std::max(1U, nBatchSize);
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nChunk) {
+            WorkerQueue& q = queues[nNextQueue++ % nQueues];
+            boost::unique_lock<boost::mutex> lock(q.mutex);
+            const size_t nEnd = std::min(vChecks.size(), nStart + nChunk);
+            for (size_t i = nStart; i < nEnd; i++) {
+                q.checks.push_back(T());
+                vChecks[i].swap(q.checks.back());
+            }
+            q.nSize = q.checks.size() - q.nHead;
+        }
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nQueued += vChecks.size();
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
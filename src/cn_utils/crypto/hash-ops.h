@@ -88,6 +88,27 @@ void hash_extra_skein(const void *data, size_t length, char *hash);
 
 void tree_hash(const char (*hashes)[HASH_SIZE], size_t count, char *root_hash);
 
+void slow_hash_allocate_state(void);
+void slow_hash_free_state(void);
+
+/* The code paths cn_slow_hash and rx_slow_hash take on this CPU. */
+struct slow_hash_info {
+  const char *cn_path;    /* implementation of cn_slow_hash in use */
+  int cpu_aes;            /* the CPU has AES instructions */
+  int cn_hw_aes;          /* cn_slow_hash uses them */
+  int cn_v4_jit;          /* CryptonightR (variant 4) code is compiled, not interpreted */
+  int rx_hw_aes;
+  int rx_jit;
+  int rx_argon2_avx2;
+  int rx_argon2_ssse3;
+};
+void slow_hash_get_info(struct slow_hash_info *info);
+void cn_slow_hash_get_info(struct slow_hash_info *info);
+void rx_slow_hash_get_info(struct slow_hash_info *info);
+/* Override the defaults, e.g. to compare paths; call before hashing starts. */
+void cn_slow_hash_set_software_aes(int force);
+void cn_slow_hash_set_v4_jit(int use);
+
 #define RX_BLOCK_VERSION	12
 void rx_slow_hash_allocate_state(void);
 void rx_slow_hash_free_state(void);
@@ -95,4 +116,7 @@ uint64_t rx_seedheight(const uint64_t height);
 void rx_seedheights(const uint64_t height, uint64_t *seed_height, uint64_t *next_height);
 int is_a_seed_height(const uint64_t height);
 void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length, char *hash, int miners, int is_alt);
+void rx_slow_hash_batch(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *const *data, const size_t *lengths, size_t count, char *hashes);
+void rx_slow_hash_nonces(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, void *data, size_t length, size_t nonce_offset, uint32_t nonce, size_t count, char *hashes, int miners);
 void rx_reorg(const uint64_t split_height);
+void rx_stop_mining(void);
@@ -37,6 +37,7 @@
 #include <limits.h>
 
 #include "randomx.h"
+#include "common/int-util.h"
 #include "c_threads.h"
 #include "hash-ops.h"
 #include "misc_log_ex.h"
@@ -195,8 +196,13 @@ static void rx_initdata(randomx_cache *rs_cache, const int miners, const uint64_
   rx_dataset_height = seedheight;
 }
 
-void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length,
-  char *hash, int miners, int is_alt) {
+/* Pick the seed slot for the given heights, (re)initialize its cache if the
+ * seed changed and bind the calling thread's VM to it. Returns the slot with
+ * its rs_mutex held; *is_altp tells the caller whether it was an altchain slot.
+ */
+static rx_state *rx_prepare_vm(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash,
+  int miners, int *is_altp) {
+  int is_alt = *is_altp;
   uint64_t s_height = rx_seedheight(mainheight);
   int toggle = (s_height & SEEDHASH_EPOCH_BLOCKS) != 0;
   randomx_flags flags = enabled_flags() & ~disabled_flags();
@@ -259,6 +265,8 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
         }
         if (rx_dataset != NULL)
           rx_initdata(rx_sp->rs_cache, miners, seedheight);
+      } else if (rx_dataset_height != seedheight) {
+        rx_initdata(rx_sp->rs_cache, miners, seedheight);
       }
       if (rx_dataset != NULL)
         flags |= RANDOMX_FLAG_FULL_MEM;
@@ -288,6 +296,14 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
     /* this is a no-op if the cache hasn't changed */
     randomx_vm_set_cache(rx_vm, rx_sp->rs_cache);
   }
+  *is_altp = is_alt;
+  return rx_sp;
+}
+
+void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash, const void *data, size_t length,
+  char *hash, int miners, int is_alt) {
+  rx_state *rx_sp = rx_prepare_vm(mainheight, seedheight, seedhash, miners, &is_alt);
+
   /* mainchain users can run in parallel */
   if (!is_alt)
     CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
@@ -297,6 +313,72 @@ void rx_slow_hash(const uint64_t mainheight, const uint64_t seedheight, const ch
     CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
 }
 
+/* Hash 'count' blobs that share one seed back-to-back on the calling thread's
+ * VM. The seed slot is checked once for the group, and each hash overlaps the
+ * scratchpad fill of the next one. Mainchain callers run in parallel like
+ * rx_slow_hash. Results are written consecutively to 'hashes', HASH_SIZE
+ * bytes each.
+ */
+void rx_slow_hash_batch(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash,
+  const void *const *data, const size_t *lengths, size_t count, char *hashes) {
+  rx_state *rx_sp;
+  int is_alt = 0;
+  size_t i;
+
+  if (count == 0)
+    return;
+
+  rx_sp = rx_prepare_vm(mainheight, seedheight, seedhash, 0, &is_alt);
+  if (!is_alt)
+    CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
+  randomx_calculate_hash_first(rx_vm, data[0], lengths[0]);
+  for (i = 1; i < count; i++)
+    randomx_calculate_hash_next(rx_vm, data[i], lengths[i], hashes + (i - 1) * HASH_SIZE);
+  randomx_calculate_hash_last(rx_vm, hashes + (count - 1) * HASH_SIZE);
+  if (is_alt)
+    CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
+}
+
+/* Hash 'count' consecutive nonces of one blob, as a miner does. The
+ * little-endian 32-bit nonce at 'nonce_offset' in 'data' is set to 'nonce',
+ * 'nonce' + 1, ... before each hash, and each hash overlaps the scratchpad
+ * fill of the next one. With 'miners' > 0 the calling thread gets a
+ * full-dataset VM; the dataset is shared by all such threads and built with
+ * 'miners' threads. Mainchain callers run in parallel like rx_slow_hash.
+ */
+void rx_slow_hash_nonces(const uint64_t mainheight, const uint64_t seedheight, const char *seedhash,
+  void *data, size_t length, size_t nonce_offset, uint32_t nonce, size_t count, char *hashes, int miners) {
+  rx_state *rx_sp;
+  int is_alt = 0;
+  unsigned char *p = (unsigned char *)data + nonce_offset;
+  size_t i;
+
+  if (count == 0 || nonce_offset + 4 > length)
+    return;
+
+  rx_sp = rx_prepare_vm(mainheight, seedheight, seedhash, miners, &is_alt);
+  if (!is_alt)
+    CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
+  memcpy_swap32le(p, &nonce, 1);
+  randomx_calculate_hash_first(rx_vm, data, length);
+  for (i = 1; i < count; i++) {
+    uint32_t next = nonce + (uint32_t)i;
+    memcpy_swap32le(p, &next, 1);
+    randomx_calculate_hash_next(rx_vm, data, length, hashes + (i - 1) * HASH_SIZE);
+  }
+  randomx_calculate_hash_last(rx_vm, hashes + (count - 1) * HASH_SIZE);
+  if (is_alt)
+    CTHR_MUTEX_UNLOCK(rx_sp->rs_mutex);
+}
+
+void rx_slow_hash_get_info(struct slow_hash_info *info) {
+  int flags = enabled_flags() & ~disabled_flags();
+  info->rx_hw_aes = (flags & RANDOMX_FLAG_HARD_AES) != 0;
+  info->rx_jit = (flags & RANDOMX_FLAG_JIT) != 0;
+  info->rx_argon2_avx2 = (flags & RANDOMX_FLAG_ARGON2_AVX2) != 0;
+  info->rx_argon2_ssse3 = (flags & RANDOMX_FLAG_ARGON2_SSSE3) != 0;
+}
+
 void rx_slow_hash_allocate_state(void) {
 }
 
@@ -65,18 +65,33 @@ static void local_abort(const char *msg)
 #endif
 }
 
-volatile int use_v4_jit_flag = 1;
+/*
+ * The CryptonightR JIT writes x86-64 code into an anonymous read/write/execute
+ * mapping. Only build it in where the AES-NI code path is used and the OS
+ * hands out such mappings by default; macOS (MAP_JIT), OpenBSD and NetBSD
+ * (W^X) refuse them, so there the interpreter is always used.
+ */
+#if !defined NO_AES && defined(__x86_64__) && \
+  (defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__) || defined(__MINGW32__))
+#define CN_V4_JIT_SUPPORTED 1
+#endif
+
+/* -1 until read from MONERO_USE_CNV4_JIT or set by cn_slow_hash_set_v4_jit() */
+volatile int use_v4_jit_flag = -1;
+/* -1 until read from MONERO_USE_SOFTWARE_AES or set by cn_slow_hash_set_software_aes() */
+volatile int use_software_aes_flag = -1;
 
 static inline int use_v4_jit(void)
 {
-#if defined(__x86_64__)
+#if defined(CN_V4_JIT_SUPPORTED)
 
   if (use_v4_jit_flag != -1)
     return use_v4_jit_flag;
 
+  /* on by default: validating CryptonightR blocks is dominated by the random math */
   const char *env = getenv("MONERO_USE_CNV4_JIT");
   if (!env) {
-    use_v4_jit_flag = 0;
+    use_v4_jit_flag = 1;
   }
   else if (!strcmp(env, "0") || !strcmp(env, "no")) {
     use_v4_jit_flag = 0;
@@ -292,18 +307,13 @@ static inline int use_v4_jit(void)
 #define VARIANT4_RANDOM_MATH_INIT() \
   v4_reg r[9]; \
   struct V4_Instruction code[NUM_INSTRUCTIONS_MAX + 1]; \
-  int jit = use_v4_jit(); \
+  int jit = 0; \
   do if (variant >= 4) \
   { \
     for (int i = 0; i < 4; ++i) \
       V4_REG_LOAD(r + i, (uint8_t*)(state.hs.w + 12) + sizeof(v4_reg) * i); \
     v4_random_math_init(code, height); \
-    if (jit) \
-    { \
-      int ret = v4_generate_JIT_code(code, hp_jitfunc, 4096); \
-      if (ret < 0) \
-        local_abort("Error generating CryptonightR code"); \
-    } \
+    jit = use_v4_jit() && v4_prepare_jit(code); \
   } while (0)
 
 #define VARIANT4_RANDOM_MATH(a, b, r, _b, _b1) \
@@ -460,7 +470,9 @@ THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
 THREADV v4_random_math_JIT_func hp_jitfunc = NULL;
 THREADV uint8_t *hp_jitfunc_memory = NULL;
-THREADV int hp_jitfunc_allocated = 0;
+THREADV int hp_jitfunc_tried = 0;
+/* set once a thread could not get executable memory for the CryptonightR JIT */
+static volatile int hp_jitfunc_unavailable = 0;
 
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
@@ -501,22 +513,20 @@ STATIC INLINE void xor64(uint64_t *a, const uint64_t b)
 
 STATIC INLINE int force_software_aes(void)
 {
-  static int use = -1;
-
-  if (use != -1)
-    return use;
+  if (use_software_aes_flag != -1)
+    return use_software_aes_flag;
 
   const char *env = getenv("MONERO_USE_SOFTWARE_AES");
   if (!env) {
-    use = 0;
+    use_software_aes_flag = 0;
   }
   else if (!strcmp(env, "0") || !strcmp(env, "no")) {
-    use = 0;
+    use_software_aes_flag = 0;
   }
   else {
-    use = 1;
+    use_software_aes_flag = 1;
   }
-  return use;
+  return use_software_aes_flag;
 }
 
 STATIC INLINE int check_aes_hw(void)
@@ -770,32 +780,40 @@ void cn_slow_hash_allocate_state(void)
         hp_allocated = 0;
         hp_state = (uint8_t *) malloc(MEMORY);
     }
+}
 
-
-#if defined(_MSC_VER) || defined(__MINGW32__)
-    hp_jitfunc_memory = (uint8_t *) VirtualAlloc(hp_jitfunc_memory, 4096 + 4095,
-                                                 MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+/**
+ * @brief compile a CryptonightR program into this thread's JIT page
+ *
+ * The executable page is mapped on first use. Returns 0 if there is no
+ * executable memory or the code does not fit, in which case the caller
+ * interprets the program instead.
+ */
+static int v4_prepare_jit(const struct V4_Instruction *code)
+{
+#if defined(CN_V4_JIT_SUPPORTED)
+    if (hp_jitfunc_memory == NULL && !hp_jitfunc_tried)
+    {
+        hp_jitfunc_tried = 1;
+#if defined(__MINGW32__)
+        hp_jitfunc_memory = (uint8_t *) VirtualAlloc(NULL, 4096, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
 #else
-#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
-  defined(__DragonFly__) || defined(__NetBSD__)
-    hp_jitfunc_memory = mmap(0, 4096 + 4095, PROT_READ | PROT_WRITE | PROT_EXEC,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
+#if defined(__FreeBSD__) || defined(__DragonFly__)
+        hp_jitfunc_memory = mmap(0, 4096, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANON, -1, 0);
 #else
-    hp_jitfunc_memory = mmap(0, 4096 + 4095, PROT_READ | PROT_WRITE | PROT_EXEC,
-                    MAP_PRIVATE | MAP_ANONYMOUS, 0, 0);
+        hp_jitfunc_memory = mmap(0, 4096, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
 #endif
-    if(hp_jitfunc_memory == MAP_FAILED)
-        hp_jitfunc_memory = NULL;
+        if (hp_jitfunc_memory == MAP_FAILED)
+            hp_jitfunc_memory = NULL;
 #endif
-    hp_jitfunc_allocated = 1;
-    if (hp_jitfunc_memory == NULL)
-    {
-        hp_jitfunc_allocated = 0;
-        hp_jitfunc_memory = malloc(4096 + 4095);
+        if (hp_jitfunc_memory == NULL)
+            hp_jitfunc_unavailable = 1;
+        hp_jitfunc = (v4_random_math_JIT_func)hp_jitfunc_memory;
     }
-    hp_jitfunc = (v4_random_math_JIT_func)((size_t)(hp_jitfunc_memory + 4095) & ~4095);
-#if !(defined(_MSC_VER) || defined(__MINGW32__))
-    mprotect(hp_jitfunc, 4096, PROT_READ | PROT_WRITE | PROT_EXEC);
+    return hp_jitfunc != NULL && v4_generate_JIT_code(code, hp_jitfunc, 4096) == 0;
+#else
+    (void)code;
+    return 0;
 #endif
 }
 
@@ -819,22 +837,22 @@ void cn_slow_hash_free_state(void)
 #endif
     }
 
-    if(!hp_jitfunc_allocated)
-        free(hp_jitfunc_memory);
-    else
+#if defined(CN_V4_JIT_SUPPORTED)
+    if(hp_jitfunc_memory != NULL)
     {
-#if defined(_MSC_VER) || defined(__MINGW32__)
+#if defined(__MINGW32__)
         VirtualFree(hp_jitfunc_memory, 0, MEM_RELEASE);
 #else
-        munmap(hp_jitfunc_memory, 4096 + 4095);
+        munmap(hp_jitfunc_memory, 4096);
 #endif
     }
+#endif
 
     hp_state = NULL;
     hp_allocated = 0;
     hp_jitfunc = NULL;
     hp_jitfunc_memory = NULL;
-    hp_jitfunc_allocated = 0;
+    hp_jitfunc_tried = 0;
 }
 
 /**
@@ -1004,6 +1022,16 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
 }
 
+void cn_slow_hash_get_info(struct slow_hash_info *info)
+{
+  info->cpu_aes = check_aes_hw() != 0;
+  info->cn_hw_aes = info->cpu_aes && !force_software_aes();
+  info->cn_path = info->cn_hw_aes ? "x86_64 AES-NI" : "x86_64 software AES";
+  /* Only a query: the scratchpad and JIT page are allocated by the first
+     hash, which falls back to the interpreter if it gets no executable memory */
+  info->cn_v4_jit = use_v4_jit() && !hp_jitfunc_unavailable;
+}
+
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
 void cn_slow_hash_allocate_state(void)
 {
@@ -1030,6 +1058,7 @@ void cn_slow_hash_free_state(void)
 #define U64(x) ((uint64_t *) (x))
 
 #define hp_jitfunc ((v4_random_math_JIT_func)NULL)
+#define v4_prepare_jit(code) 0
 
 STATIC INLINE void xor64(uint64_t *a, const uint64_t b)
 {
@@ -1340,6 +1369,15 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int
     aligned_free(hp_state);
 #endif
 }
+
+void cn_slow_hash_get_info(struct slow_hash_info *info)
+{
+  info->cn_path = "ARMv8 crypto extensions";
+  info->cpu_aes = 1;
+  info->cn_hw_aes = 1;
+  info->cn_v4_jit = 0;
+}
+
 #else /* aarch64 && crypto */
 
 // ND: Some minor optimizations for ARMv7 (raspberrry pi 2), effect seems to be ~40-50% faster.
@@ -1571,12 +1609,22 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int
     free(long_state);
 #endif
 }
+
+void cn_slow_hash_get_info(struct slow_hash_info *info)
+{
+  info->cn_path = "ARM software AES";
+  info->cpu_aes = 0;
+  info->cn_hw_aes = 0;
+  info->cn_v4_jit = 0;
+}
+
 #endif /* !aarch64 || !crypto */
 
 #else
 // Portable implementation as a fallback
 
 #define hp_jitfunc ((v4_random_math_JIT_func)NULL)
+#define v4_prepare_jit(code) 0
 
 void cn_slow_hash_allocate_state(void)
 {
@@ -1760,6 +1808,14 @@ void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int
 #endif
 }
 
+void cn_slow_hash_get_info(struct slow_hash_info *info)
+{
+  info->cn_path = "portable";
+  info->cpu_aes = 0;
+  info->cn_hw_aes = 0;
+  info->cn_v4_jit = 0;
+}
+
 #endif
 
 void slow_hash_allocate_state(void)
@@ -1773,3 +1829,19 @@ void slow_hash_free_state(void)
   cn_slow_hash_free_state();
   rx_slow_hash_free_state();
 }
+
+void slow_hash_get_info(struct slow_hash_info *info)
+{
+  cn_slow_hash_get_info(info);
+  rx_slow_hash_get_info(info);
+}
+
+void cn_slow_hash_set_software_aes(int force)
+{
+  use_software_aes_flag = force ? 1 : 0;
+}
+
+void cn_slow_hash_set_v4_jit(int use)
+{
+  use_v4_jit_flag = use ? 1 : 0;
+}
@@ -38,6 +38,7 @@ public:
 	virtual ~randomx_vm() = 0;
 	virtual void allocate() = 0;
 	virtual void getFinalResult(void* out, size_t outSize) = 0;
+	virtual void hashAndFill(void* out, size_t outSize, uint64_t (&fill_state)[8]) = 0;
 	virtual void setDataset(randomx_dataset* dataset) { }
 	virtual void setCache(randomx_cache* cache) { }
 	virtual void initScratchpad(void* seed) = 0;
@@ -53,6 +54,7 @@ public:
 	{
 		return program;
 	}
+	alignas(16) uint64_t tempHash[8]; //state kept between randomx_calculate_hash_first/next/last
 protected:
 	void initialize();
 	alignas(64) randomx::Program program;
@@ -78,6 +80,7 @@ namespace randomx {
 		void allocate() override;
 		void initScratchpad(void* seed) override;
 		void getFinalResult(void* out, size_t outSize) override;
+		void hashAndFill(void* out, size_t outSize, uint64_t (&fill_state)[8]) override;
 	protected:
 		void generateProgram(void* seed);
 	};
@@ -0,0 +1,655 @@
+// Copyright (c) 2018 the Kevacoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <cnjobserver.h>
+
+#include <chain.h>
+#include <consensus/consensus.h>
+#include <netbase.h>
+#include <rpc/protocol.h>
+#include <rpc/server.h>
+#include <txmempool.h>
+#include <ui_interface.h>
+#include <util.h>
+#include <utilstrencodings.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <tuple>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+#include <univalue.h>
+
+/** Maximum number of connected clients */
+static const size_t MAX_CN_JOB_CLIENTS = 64;
+/** Maximum length of a request line; a submitted blob may carry a whole block in hex */
+static const size_t MAX_CN_JOB_LINE_LENGTH = 2 * MAX_BLOCK_SERIALIZED_SIZE + 4096;
+/** Clients that let this much output queue up are disconnected */
+static const size_t MAX_CN_JOB_SEND_BUFFER = 64 * 1024 * 1024;
+/** Default reserve_size for login */
+static const int DEFAULT_CN_JOB_RESERVE_SIZE = 8;
+/**
+ * Seconds between checks for a new mempool generation. getblocktemplate only
+ * rebuilds templates for one every 5 seconds, so polling faster is wasted.
+ */
+static const int CN_JOB_POLL_INTERVAL = 5;
+
+struct CNJobClient
+{
+    struct bufferevent* bev = nullptr;
+    bool fLoggedIn = false;
+    int nReserveSize = DEFAULT_CN_JOB_RESERVE_SIZE;
+    std::string strWalletAddress;
+    bool fCompact = false;
+    //! longpollid of the last job sent, which changes with the template
+    std::string strLastJob;
+    //! A request is being handled by the worker; further lines wait in the input buffer
+    bool fBusy = false;
+};
+
+/** Parameters a job depends on, shared by all clients that log in with them. */
+typedef std::tuple<int, std::string, bool> CNJobKey;
+
+static CNJobKey GetJobKey(const CNJobClient& client)
+{
+    return CNJobKey(client.nReserveSize, client.strWalletAddress, client.fCompact);
+}
+
+/** State below is only accessed from the event loop thread. */
+static struct event_base* eventBase = nullptr;
+static struct evconnlistener* eventListener = nullptr;
+static struct event* eventUpdate = nullptr;
+static struct event* eventTimer = nullptr;
+static std::thread threadCNJobServer;
+//! Clients by id; callbacks refer to clients by id so they can outlive a connection
+static std::map<uint64_t, CNJobClient> mapClients;
+static uint64_t nNextClientId = 0;
+static unsigned int nLastTransactionsUpdated = 0;
+static bool fJobsPending = false;
+//! A job update is running on the worker thread
+static bool fUpdateRunning = false;
+//! Another update was requested while one was running
+static bool fUpdateAgain = false;
+static bool fUpdateAgainForce = false;
+//! Localhost and the -cnjoballowip subnets
+static std::vector<CSubNet> vAllowedSubnets;
+
+/**
+ * getblocktemplate and submitblock take cs_main and may take long, so they
+ * run on a worker thread instead of stalling the event loop.
+ */
+static std::mutex cs_work;
+static std::condition_variable cvWork;
+static std::deque<std::function<void()>> queueWork;
+static bool fWorkStop = false;
+static std::thread threadCNJobWorker;
+//! Results the worker hands back to the event loop, run by eventResults
+static std::deque<std::function<void()>> queueResults;
+static struct event* eventResults = nullptr;
+
+class CNJobNotifier : public CValidationInterface
+{
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        if (!fInitialDownload && eventUpdate) {
+            event_active(eventUpdate, 0, 0);
+        }
+    }
+};
+
+static std::unique_ptr<CNJobNotifier> g_cn_job_notifier;
+
+/** Queue a call for the worker thread. */
+static void PostWork(std::function<void()> func)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_work);
+        queueWork.push_back(std::move(func));
+    }
+    cvWork.notify_one();
+}
+
+/**
+ * Run a function on the event loop thread; used by the worker to hand back
+ * results. Dropped once the server is shutting down, as the loop may not run
+ * again.
+ */
+static void RunInEventLoop(std::function<void()> func)
+{
+    std::lock_guard<std::mutex> lock(cs_work);
+    if (fWorkStop) {
+        return;
+    }
+    queueResults.push_back(std::move(func));
+    event_active(eventResults, 0, 0);
+}
+
+static void results_cb(evutil_socket_t, short, void*)
+{
+    std::deque<std::function<void()>> queue;
+    {
+        std::lock_guard<std::mutex> lock(cs_work);
+        queue.swap(queueResults);
+    }
+    for (const std::function<void()>& func : queue) {
+        func();
+    }
+}
+
+static void ThreadCNJobWorker()
+{
+    RenameThread("kevacoin-cnjobw");
+    std::unique_lock<std::mutex> lock(cs_work);
+    while (true) {
+        cvWork.wait(lock, [] { return fWorkStop || !queueWork.empty(); });
+        if (fWorkStop) {
+            return;
+        }
+        std::function<void()> func = std::move(queueWork.front());
+        queueWork.pop_front();
+        lock.unlock();
+        func();
+        lock.lock();
+    }
+}
+
+static CNJobClient* FindClient(uint64_t nClientId)
+{
+    auto it = mapClients.find(nClientId);
+    return it == mapClients.end() ? nullptr : &it->second;
+}
+
+static void Send(struct bufferevent* bev, const UniValue& msg)
+{
+    std::string str = msg.write() + "\n";
+    bufferevent_write(bev, str.data(), str.size());
+}
+
+static void Disconnect(uint64_t nClientId)
+{
+    auto it = mapClients.find(nClientId);
+    if (it == mapClients.end()) {
+        return;
+    }
+    bufferevent_free(it->second.bev);
+    mapClients.erase(it);
+}
+
+/** Send a message, disconnecting clients that stopped reading. Returns false if the client was dropped. */
+static bool SendOrDisconnect(uint64_t nClientId, const UniValue& msg)
+{
+    CNJobClient* client = FindClient(nClientId);
+    if (!client) {
+        return false;
+    }
+    Send(client->bev, msg);
+    if (evbuffer_get_length(bufferevent_get_output(client->bev)) > MAX_CN_JOB_SEND_BUFFER) {
+        LogPrint(BCLog::RPC, "cnjob: client is not reading, disconnecting\n");
+        Disconnect(nClientId);
+        return false;
+    }
+    return true;
+}
+
+/** Fetch the current job of a client through the Cryptonote getblocktemplate RPC. */
+static UniValue GetJob(const CNJobClient& client)
+{
+    JSONRPCRequest request;
+    request.strMethod = "getblocktemplate";
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(client.nReserveSize);
+    request.params.push_back(client.strWalletAddress);
+    request.params.push_back(NullUniValue);
+    request.params.push_back(client.fCompact);
+    return tableRPC.execute(request);
+}
+
+static CNJobClient ParseLogin(const UniValue& params)
+{
+    if (!params.isObject()) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, "Expected login parameters object");
+    }
+    const UniValue& address = find_value(params, "wallet_address");
+    const UniValue& reserveSize = find_value(params, "reserve_size");
+    const UniValue& compact = find_value(params, "compact");
+    if (!address.isStr()) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, "wallet_address must be a string");
+    }
+    if (!reserveSize.isNull() && !reserveSize.isNum()) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, "reserve_size must be an integer");
+    }
+    if (!compact.isNull() && !compact.isBool()) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, "compact must be a boolean");
+    }
+
+    CNJobClient login;
+    login.strWalletAddress = address.get_str();
+    login.nReserveSize = reserveSize.isNull() ? DEFAULT_CN_JOB_RESERVE_SIZE : reserveSize.get_int();
+    login.fCompact = compact.isNull() ? false : compact.get_bool();
+    return login;
+}
+
+static JSONRPCRequest ParseSubmit(const CNJobClient& client, const UniValue& params)
+{
+    if (!client.fLoggedIn) {
+        throw JSONRPCError(RPC_INVALID_REQUEST, "Not logged in");
+    }
+    if (!params.isObject()) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, "Expected submit parameters object");
+    }
+    const UniValue& blob = find_value(params, "blob");
+    const UniValue& body = find_value(params, "blockbody");
+    if (!blob.isStr()) {
+        throw JSONRPCError(RPC_INVALID_PARAMS, "blob must be a string");
+    }
+
+    JSONRPCRequest request;
+    request.strMethod = "submitblock";
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(blob);
+    if (!body.isNull()) {
+        request.params.push_back(body);
+    }
+    return request;
+}
+
+static void ProcessLines(uint64_t nClientId);
+
+/**
+ * Run a call on the worker thread and reply to the client from the event
+ * loop. onSuccess is applied to the client before the reply is sent.
+ */
+static void CallAsync(uint64_t nClientId, const UniValue& id, const std::function<UniValue()>& call,
+                      const std::function<void(CNJobClient&, const UniValue&)>& onSuccess)
+{
+    FindClient(nClientId)->fBusy = true;
+    PostWork([nClientId, id, call, onSuccess] {
+        UniValue result;
+        UniValue error;
+        try {
+            result = call();
+        } catch (const UniValue& objError) {
+            error = objError;
+        } catch (const std::exception& e) {
+            error = JSONRPCError(RPC_MISC_ERROR, e.what());
+        }
+        RunInEventLoop([nClientId, id, result, error, onSuccess] {
+            CNJobClient* client = FindClient(nClientId);
+            if (!client) {
+                return;
+            }
+            if (error.isNull()) {
+                onSuccess(*client, result);
+            }
+            client->fBusy = false;
+            if (SendOrDisconnect(nClientId, JSONRPCReplyObj(result, error, id))) {
+                ProcessLines(nClientId);
+            }
+        });
+    });
+}
+
+/** Handle a request line. Returns the reply, or null if the reply is sent once the worker is done. */
+static UniValue HandleRequest(uint64_t nClientId, CNJobClient& client, const std::string& line)
+{
+    UniValue id;
+    try {
+        UniValue request;
+        if (!request.read(line) || !request.isObject()) {
+            throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
+        }
+        id = find_value(request, "id");
+        const UniValue& method = find_value(request, "method");
+        if (!method.isStr()) {
+            throw JSONRPCError(RPC_INVALID_REQUEST, "Method must be a string");
+        }
+        const UniValue& params = find_value(request, "params");
+        std::string strWarmupStatus;
+        if (RPCIsInWarmup(&strWarmupStatus)) {
+            throw JSONRPCError(RPC_IN_WARMUP, strWarmupStatus);
+        }
+        if (method.get_str() == "login") {
+            const CNJobClient login = ParseLogin(params);
+            CallAsync(nClientId, id, [login] { return GetJob(login); },
+                [login](CNJobClient& c, const UniValue& job) {
+                    c.fLoggedIn = true;
+                    c.nReserveSize = login.nReserveSize;
+                    c.strWalletAddress = login.strWalletAddress;
+                    c.fCompact = login.fCompact;
+                    c.strLastJob = find_value(job, "longpollid").get_str();
+                });
+        } else if (method.get_str() == "submit") {
+            const JSONRPCRequest submit = ParseSubmit(client, params);
+            CallAsync(nClientId, id, [submit] { return tableRPC.execute(submit); },
+                [](CNJobClient&, const UniValue&) {});
+        } else {
+            throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
+        }
+        return NullUniValue;
+    } catch (const UniValue& objError) {
+        return JSONRPCReplyObj(NullUniValue, objError, id);
+    } catch (const std::exception& e) {
+        return JSONRPCReplyObj(NullUniValue, JSONRPCError(RPC_MISC_ERROR, e.what()), id);
+    }
+}
+
+/** Handle buffered request lines of a client, one at a time. */
+static void ProcessLines(uint64_t nClientId)
+{
+    CNJobClient* client;
+    while ((client = FindClient(nClientId)) != nullptr && !client->fBusy) {
+        struct evbuffer* input = bufferevent_get_input(client->bev);
+        size_t n_read_out = 0;
+        char* line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF);
+        if (!line) {
+            if (evbuffer_get_length(input) > MAX_CN_JOB_LINE_LENGTH) {
+                LogPrint(BCLog::RPC, "cnjob: request line too long, disconnecting\n");
+                Disconnect(nClientId);
+            }
+            return;
+        }
+        std::string s(line, n_read_out);
+        free(line);
+        const UniValue reply = HandleRequest(nClientId, *client, s);
+        if (!reply.isNull() && !SendOrDisconnect(nClientId, reply)) {
+            return;
+        }
+    }
+    // Bound the lines queued up behind a busy request
+    if (client && evbuffer_get_length(bufferevent_get_input(client->bev)) > MAX_CN_JOB_LINE_LENGTH) {
+        LogPrint(BCLog::RPC, "cnjob: too much input queued, disconnecting\n");
+        Disconnect(nClientId);
+    }
+}
+
+static void UpdateJobs(bool fForce);
+
+/** Push the jobs fetched by the worker to every client whose template changed. */
+static void FinishUpdateJobs(const std::map<CNJobKey, UniValue>& mapJobs, const std::string& strSuffix)
+{
+    fUpdateRunning = false;
+    for (const auto& entry : mapJobs) {
+        const std::string& strJob = find_value(entry.second, "longpollid").get_str();
+        if (strJob.size() < 64 || strJob.substr(64) != strSuffix) {
+            fJobsPending = true;
+        }
+    }
+
+    std::vector<uint64_t> vClientIds;
+    for (const auto& entry : mapClients) {
+        vClientIds.push_back(entry.first);
+    }
+    for (uint64_t nClientId : vClientIds) {
+        CNJobClient* client = FindClient(nClientId);
+        if (!client || !client->fLoggedIn) {
+            continue;
+        }
+        auto it = mapJobs.find(GetJobKey(*client));
+        if (it == mapJobs.end()) {
+            continue;
+        }
+        const std::string& strJob = find_value(it->second, "longpollid").get_str();
+        if (strJob == client->strLastJob) {
+            continue;
+        }
+        client->strLastJob = strJob;
+
+        UniValue notification(UniValue::VOBJ);
+        notification.push_back(Pair("method", "job"));
+        notification.push_back(Pair("params", it->second));
+        SendOrDisconnect(nClientId, notification);
+    }
+
+    if (fUpdateAgain) {
+        fUpdateAgain = false;
+        UpdateJobs(fUpdateAgainForce);
+    }
+}
+
+/**
+ * Push a job to every client whose template changed. Templates for a new
+ * mempool generation are only built after a few seconds (see
+ * getblocktemplate), so keep checking until all clients caught up. Clients
+ * that share login parameters share one getblocktemplate call.
+ */
+static void UpdateJobs(bool fForce)
+{
+    if (fUpdateRunning) {
+        fUpdateAgainForce = fUpdateAgain ? (fUpdateAgainForce || fForce) : fForce;
+        fUpdateAgain = true;
+        return;
+    }
+    const unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    if (!fForce && !fJobsPending && nTransactionsUpdated == nLastTransactionsUpdated) {
+        return;
+    }
+    nLastTransactionsUpdated = nTransactionsUpdated;
+    fJobsPending = false;
+
+    std::set<CNJobKey> setKeys;
+    for (const auto& entry : mapClients) {
+        if (entry.second.fLoggedIn) {
+            setKeys.insert(GetJobKey(entry.second));
+        }
+    }
+    if (setKeys.empty()) {
+        return;
+    }
+
+    // longpollid is the tip hash followed by the mempool generation
+    const std::string strSuffix = i64tostr(nTransactionsUpdated);
+    fUpdateRunning = true;
+    PostWork([setKeys, strSuffix] {
+        std::map<CNJobKey, UniValue> mapJobs;
+        for (const CNJobKey& key : setKeys) {
+            CNJobClient client;
+            std::tie(client.nReserveSize, client.strWalletAddress, client.fCompact) = key;
+            try {
+                mapJobs.emplace(key, GetJob(client));
+            } catch (const UniValue& objError) {
+                LogPrint(BCLog::RPC, "cnjob: failed to get a job: %s\n", find_value(objError, "message").getValStr());
+            } catch (const std::exception& e) {
+                LogPrint(BCLog::RPC, "cnjob: failed to get a job: %s\n", e.what());
+            }
+        }
+        RunInEventLoop([mapJobs, strSuffix] { FinishUpdateJobs(mapJobs, strSuffix); });
+    });
+}
+
+static void update_cb(evutil_socket_t, short, void*)
+{
+    UpdateJobs(true);
+}
+
+static void timer_cb(evutil_socket_t, short, void*)
+{
+    UpdateJobs(false);
+}
+
+static void read_cb(struct bufferevent*, void* ctx)
+{
+    ProcessLines((uint64_t)(uintptr_t)ctx);
+}
+
+static void event_cb(struct bufferevent*, short what, void* ctx)
+{
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        Disconnect((uint64_t)(uintptr_t)ctx);
+    }
+}
+
+static bool ClientAllowed(const struct sockaddr* addr)
+{
+    CService peer;
+    if (!peer.SetSockAddr(addr)) {
+        return false;
+    }
+    for (const CSubNet& subnet : vAllowedSubnets) {
+        if (subnet.Match(peer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void accept_cb(struct evconnlistener*, evutil_socket_t fd, struct sockaddr* addr, int, void*)
+{
+    if (!ClientAllowed(addr)) {
+        LogPrint(BCLog::RPC, "cnjob: connection from a client not allowed by -cnjoballowip, rejecting\n");
+        evutil_closesocket(fd);
+        return;
+    }
+    if (mapClients.size() >= MAX_CN_JOB_CLIENTS) {
+        LogPrint(BCLog::RPC, "cnjob: too many clients, rejecting connection\n");
+        evutil_closesocket(fd);
+        return;
+    }
+    struct bufferevent* bev = bufferevent_socket_new(eventBase, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    const uint64_t nClientId = nNextClientId++;
+    bufferevent_setcb(bev, read_cb, nullptr, event_cb, (void*)(uintptr_t)nClientId);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    mapClients[nClientId].bev = bev;
+}
+
+static void ThreadCNJobServer(struct event_base* base)
+{
+    RenameThread("kevacoin-cnjob");
+    event_base_dispatch(base);
+}
+
+bool StartCNJobServer()
+{
+    const int nPort = gArgs.GetArg("-cnjobport", DEFAULT_CN_JOB_PORT);
+    if (nPort <= 0) {
+        return true;
+    }
+    const std::string strBind = gArgs.GetArg("-cnjobbind", DEFAULT_CN_JOB_BIND);
+    CService addrBind = LookupNumeric(strBind.c_str(), nPort);
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addrBind.IsValid() || !addrBind.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        return InitError(strprintf(_("Invalid -cnjobbind address: '%s'"), strBind));
+    }
+
+    // Clients get templates paying wherever they like and submit blocks
+    // without RPC credentials, so only trusted hosts may connect.
+    vAllowedSubnets.clear();
+    CNetAddr localv4;
+    CNetAddr localv6;
+    LookupHost("127.0.0.1", localv4, false);
+    LookupHost("::1", localv6, false);
+    vAllowedSubnets.push_back(CSubNet(localv4, 8));
+    vAllowedSubnets.push_back(CSubNet(localv6));
+    for (const std::string& strAllow : gArgs.GetArgs("-cnjoballowip")) {
+        CSubNet subnet;
+        LookupSubNet(strAllow.c_str(), subnet);
+        if (!subnet.IsValid()) {
+            return InitError(strprintf(_("Invalid -cnjoballowip subnet specification: %s"), strAllow));
+        }
+        vAllowedSubnets.push_back(subnet);
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    eventBase = event_base_new();
+    if (!eventBase) {
+        return InitError(_("Unable to create the Cryptonote job server event base."));
+    }
+    eventListener = evconnlistener_new_bind(eventBase, accept_cb, nullptr, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+                                            (struct sockaddr*)&sockaddr, len);
+    if (!eventListener) {
+        event_base_free(eventBase);
+        eventBase = nullptr;
+        return InitError(strprintf(_("Unable to bind the Cryptonote job server to %s."), addrBind.ToString()));
+    }
+    eventUpdate = event_new(eventBase, -1, 0, update_cb, nullptr);
+    eventResults = event_new(eventBase, -1, 0, results_cb, nullptr);
+    eventTimer = event_new(eventBase, -1, EV_PERSIST, timer_cb, nullptr);
+    struct timeval tv = {CN_JOB_POLL_INTERVAL, 0};
+    event_add(eventTimer, &tv);
+
+    g_cn_job_notifier.reset(new CNJobNotifier());
+    RegisterValidationInterface(g_cn_job_notifier.get());
+
+    LogPrintf("Cryptonote job server listening on %s\n", addrBind.ToString());
+    fWorkStop = false;
+    threadCNJobWorker = std::thread(ThreadCNJobWorker);
+    threadCNJobServer = std::thread(ThreadCNJobServer, eventBase);
+    return true;
+}
+
+void InterruptCNJobServer()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_work);
+        fWorkStop = true;
+    }
+    cvWork.notify_all();
+    if (eventBase) {
+        event_base_loopbreak(eventBase);
+    }
+}
+
+void StopCNJobServer()
+{
+    if (g_cn_job_notifier) {
+        UnregisterValidationInterface(g_cn_job_notifier.get());
+        // Make sure no queued UpdatedBlockTip still refers to eventUpdate
+        SyncWithValidationInterfaceQueue();
+    }
+    if (threadCNJobWorker.joinable()) {
+        threadCNJobWorker.join();
+    }
+    queueWork.clear();
+    queueResults.clear();
+    if (threadCNJobServer.joinable()) {
+        threadCNJobServer.join();
+    }
+    for (auto& entry : mapClients) {
+        bufferevent_free(entry.second.bev);
+    }
+    mapClients.clear();
+    if (eventTimer) {
+        event_free(eventTimer);
+        eventTimer = nullptr;
+    }
+    if (eventUpdate) {
+        event_free(eventUpdate);
+        eventUpdate = nullptr;
+    }
+    if (eventResults) {
+        event_free(eventResults);
+        eventResults = nullptr;
+    }
+    if (eventListener) {
+        evconnlistener_free(eventListener);
+        eventListener = nullptr;
+    }
+    if (eventBase) {
+        event_base_free(eventBase);
+        eventBase = nullptr;
+    }
+    g_cn_job_notifier.reset();
+}
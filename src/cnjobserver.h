@@ -0,0 +1,39 @@
+// Copyright (c) 2018 the Kevacoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Push server for Cryptonote mining jobs.
+ *
+ * Clients connect over TCP and exchange newline delimited JSON-RPC objects:
+ *
+ *   -> {"id": 1, "method": "login", "params": {"wallet_address": "...", "reserve_size": 8, "compact": false}}
+ *   <- {"id": 1, "result": <job>, "error": null}
+ *   <- {"method": "job", "params": <job>}
+ *   -> {"id": 2, "method": "submit", "params": {"blob": "...", "blockbody": "..."}}
+ *   <- {"id": 2, "result": {"status": "OK"}, "error": null}
+ *
+ * A job is the result of the Cryptonote getblocktemplate RPC, and submit is
+ * handled by submitblock, so both share the template cache in rpc/mining.cpp.
+ * A new job is pushed whenever the template of a client changes, i.e. on a
+ * new tip or a new mempool generation. The RPC calls run on a worker thread,
+ * and each client has at most one request in flight. There is no
+ * authentication, so only localhost and the -cnjoballowip subnets may
+ * connect.
+ */
+#ifndef BITCOIN_CNJOBSERVER_H
+#define BITCOIN_CNJOBSERVER_H
+
+#include <string>
+
+static const int DEFAULT_CN_JOB_PORT = 0;
+static const char* const DEFAULT_CN_JOB_BIND = "127.0.0.1";
+
+/** Start the job server if -cnjobport is set. */
+bool StartCNJobServer();
+/** Stop accepting connections and break the event loop. */
+void InterruptCNJobServer();
+/** Disconnect all clients and free the server. */
+void StopCNJobServer();
+
+#endif // BITCOIN_CNJOBSERVER_H
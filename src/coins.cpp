@@ -78,6 +78,16 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     return ret;
 }
 
+void CCoinsViewCache::CacheCoins(const std::vector<COutPoint>& vOutpoints, std::vector<Coin>& vCoins) {
+    assert(vOutpoints.size() == vCoins.size());
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (vCoins[i].IsSpent() || cacheCoins.count(vOutpoints[i]))
+            continue;
+        CCoinsMap::iterator it = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(vOutpoints[i]), std::forward_as_tuple(std::move(vCoins[i]))).first;
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+}
+
 bool CCoinsViewCache::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     CCoinsMap::const_iterator it = FetchCoin(outpoint);
     if (it != cacheCoins.end()) {
@@ -311,6 +311,13 @@ public:
      */
     void Uncache(const COutPoint &outpoint);
 
+    /**
+     * Cache coins that were read from the base view ahead of time, unless
+     * their outpoint is cached already. They must match the current state
+     * of the base. Spent coins are skipped, and vCoins is left moved from.
+     */
+    void CacheCoins(const std::vector<COutPoint>& vOutpoints, std::vector<Coin>& vCoins);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
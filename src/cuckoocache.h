@@ -197,6 +197,9 @@ private:
      * Should be set to log2(n)*/
     uint8_t depth_limit;
 
+    /** epoch_count is the number of times a new epoch was started */
+    uint64_t epoch_count;
+
     /** hash_function is a const instance of the hash function. It cannot be
      * static or initialized at call time as it may have internal state (such as
      * a nonce).
@@ -309,6 +312,7 @@ private:
                 else
                     allow_erase(i);
             epoch_heuristic_counter = epoch_size;
+            ++epoch_count;
         } else
             // reset the epoch_heuristic_counter to next do a scan when worst
             // case behavior (no intermittent erases) would exceed epoch size,
@@ -320,12 +324,67 @@ private:
                         epoch_size - epoch_unused_count));
     }
 
+    /** insert_with_epoch does the work of insert() for an element that
+     * belongs to the epoch given by epoch (true for the current one).
+     *
+     * @returns false if an element was dropped to make room
+     */
+    bool insert_with_epoch(Element e, bool epoch)
+    {
+        uint32_t last_loc = invalid();
+        bool last_epoch = epoch;
+        std::array<uint32_t, 8> locs = compute_hashes(e);
+        // Make sure we have not already inserted this element
+        // If we have, make sure that it does not get deleted
+        for (uint32_t loc : locs)
+            if (table[loc] == e) {
+                please_keep(loc);
+                epoch_flags[loc] = last_epoch;
+                return true;
+            }
+        for (uint8_t depth = 0; depth < depth_limit; ++depth) {
+            // First try to insert to an empty slot, if one exists
+            for (uint32_t loc : locs) {
+                if (!collection_flags.bit_is_set(loc))
+                    continue;
+                table[loc] = std::move(e);
+                please_keep(loc);
+                epoch_flags[loc] = last_epoch;
+                return true;
+            }
+            /** Swap with the element at the location that was
+            * not the last one looked at. Example:
+            *
+            * 1) On first iteration, last_loc == invalid(), find returns last, so
+            *    last_loc defaults to locs[0].
+            * 2) On further iterations, where last_loc == locs[k], last_loc will
+            *    go to locs[k+1 % 8], i.e., next of the 8 indices wrapping around
+            *    to 0 if needed.
+            *
+            * This prevents moving the element we just put in.
+            *
+            * The swap is not a move -- we must switch onto the evicted element
+            * for the next iteration.
+            */
+            last_loc = locs[(1 + (std::find(locs.begin(), locs.end(), last_loc) - locs.begin())) & 7];
+            std::swap(table[last_loc], e);
+            // Can't std::swap a std::vector<bool>::reference and a bool&.
+            bool epoch = last_epoch;
+            last_epoch = epoch_flags[last_loc];
+            epoch_flags[last_loc] = epoch;
+
+            // Recompute the locs -- unfortunately happens one too many times!
+            locs = compute_hashes(e);
+        }
+        return false;
+    }
+
 public:
     /** You must always construct a cache with some elements via a subsequent
      * call to setup or setup_bytes, otherwise operations may segfault.
      */
     cache() : table(), size(), collection_flags(0), epoch_flags(),
-    epoch_heuristic_counter(), epoch_size(), depth_limit(0), hash_function()
+    epoch_heuristic_counter(), epoch_size(), depth_limit(0), epoch_count(0), hash_function()
     {
     }
 
@@ -369,6 +428,59 @@ public:
         return setup(bytes/sizeof(Element));
     }
 
+    /** resize changes the container to store no more than new_size elements
+     * and inserts the elements that are not marked for erasure again, keeping
+     * the epoch they belong to. When growing nothing is lost unless an insert
+     * runs out of depth; when shrinking below the number of live elements
+     * some of them are dropped.
+     *
+     * Not threadsafe: no other operation may run concurrently.
+     *
+     * @param new_size the desired number of elements to store
+     * @param dropped if not null, set to the number of live elements lost
+     * @returns the maximum number of elements storable
+     */
+    uint32_t resize(uint32_t new_size, uint32_t* dropped = nullptr)
+    {
+        std::vector<Element> old_table;
+        std::vector<bool> old_epoch_flags;
+        std::swap(old_table, table);
+        std::swap(old_epoch_flags, epoch_flags);
+        std::vector<bool> live(size);
+        for (uint32_t i = 0; i < size; ++i)
+            live[i] = !collection_flags.bit_is_set(i);
+        const uint32_t old_size = size;
+
+        setup(new_size);
+        uint32_t n_dropped = 0;
+        for (uint32_t i = 0; i < old_size; ++i)
+            if (live[i] && !insert_with_epoch(std::move(old_table[i]), old_epoch_flags[i]))
+                ++n_dropped;
+        // The table may already be well filled, so scan on the next insert
+        epoch_heuristic_counter = 0;
+        if (dropped)
+            *dropped = n_dropped;
+        return size;
+    }
+
+    /** resize_bytes is resize() with the size given in bytes, see setup_bytes() */
+    uint32_t resize_bytes(size_t bytes, uint32_t* dropped = nullptr)
+    {
+        return resize(bytes/sizeof(Element), dropped);
+    }
+
+    /** @returns the number of elements the container can store */
+    uint32_t capacity() const
+    {
+        return size;
+    }
+
+    /** @returns the number of epochs started so far */
+    uint64_t generations() const
+    {
+        return epoch_count;
+    }
+
     /** insert loops at most depth_limit times trying to insert a hash
      * at various locations in the table via a variant of the Cuckoo Algorithm
      * with eight hash locations.
@@ -388,55 +500,12 @@ public:
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
      *
+     * @returns false if an element was evicted
      */
-    inline void insert(Element e)
+    inline bool insert(Element e)
     {
         epoch_check();
-        uint32_t last_loc = invalid();
-        bool last_epoch = true;
-        std::array<uint32_t, 8> locs = compute_hashes(e);
-        // Make sure we have not already inserted this element
-        // If we have, make sure that it does not get deleted
-        for (uint32_t loc : locs)
-            if (table[loc] == e) {
-                please_keep(loc);
-                epoch_flags[loc] = last_epoch;
-                return;
-            }
-        for (uint8_t depth = 0; depth < depth_limit; ++depth) {
-            // First try to insert to an empty slot, if one exists
-            for (uint32_t loc : locs) {
-                if (!collection_flags.bit_is_set(loc))
-                    continue;
-                table[loc] = std::move(e);
-                please_keep(loc);
-                epoch_flags[loc] = last_epoch;
-                return;
-            }
-            /** Swap with the element at the location that was
-            * not the last one looked at. Example:
-            *
-            * 1) On first iteration, last_loc == invalid(), find returns last, so
-            *    last_loc defaults to locs[0].
-            * 2) On further iterations, where last_loc == locs[k], last_loc will
-            *    go to locs[k+1 % 8], i.e., next of the 8 indices wrapping around
-            *    to 0 if needed.
-            *
-            * This prevents moving the element we just put in.
-            *
-            * The swap is not a move -- we must switch onto the evicted element
-            * for the next iteration.
-            */
-            last_loc = locs[(1 + (std::find(locs.begin(), locs.end(), last_loc) - locs.begin())) & 7];
-            std::swap(table[last_loc], e);
-            // Can't std::swap a std::vector<bool>::reference and a bool&.
-            bool epoch = last_epoch;
-            last_epoch = epoch_flags[last_loc];
-            epoch_flags[last_loc] = epoch;
-
-            // Recompute the locs -- unfortunately happens one too many times!
-            locs = compute_hashes(e);
-        }
+        return insert_with_epoch(std::move(e), true);
     }
 
     /* contains iterates through the hash locations for a given element
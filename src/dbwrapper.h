@@ -16,6 +16,8 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <memory>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
@@ -223,14 +225,27 @@ public:
 
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
+    {
+        return Read(key, value, nullptr);
+    }
+
+    /**
+     * Read from a snapshot taken with GetSnapshot, or from the current state
+     * of the database if snapshot is nullptr. Safe to call from several
+     * threads at once.
+     */
+    template <typename K, typename V>
+    bool Read(const K& key, V& value, const leveldb::Snapshot* snapshot) const
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
         ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
         ssKey << key;
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
+        leveldb::ReadOptions options = readoptions;
+        options.snapshot = snapshot;
         std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(options, slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -301,6 +316,13 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /** Take a snapshot of the current state of the database, released when the last copy goes away. */
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot() const
+    {
+        leveldb::DB* db = pdb;
+        return std::shared_ptr<const leveldb::Snapshot>(pdb->GetSnapshot(), [db](const leveldb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); });
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
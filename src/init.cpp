@@ -14,6 +14,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
+#include <cnjobserver.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
 #include <fs.h>
@@ -167,6 +168,7 @@ void Interrupt()
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptCNJobServer();
     if (g_connman)
         g_connman->Interrupt();
 }
@@ -186,6 +188,7 @@ void Shutdown()
     RenameThread("kevacoin-shutoff");
     mempool.AddTransactionsUpdated(1);
 
+    StopCNJobServer();
     StopHTTPRPC();
     StopREST();
     StopRPC();
@@ -346,6 +349,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-assumevalidpow=<hex>", _("If this block is in the chain assume that it and its ancestors have valid proof of work. If it is a checkpoint, the proof of work of headers below it is only checked for headers that turn out not to lead to it (0 to verify all, default: 0)"));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND)
     {
@@ -372,6 +376,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-parblock=<n>", strprintf(_("Set the number of threads checking the transactions of incoming blocks (0 to %d, 0 = none, default: same as -par)"),
+        MAX_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-blockprefetch", _("Read the next block to connect and its inputs in a separate thread while the current one is connected (default: 1 if -par allows more than one script verification thread)"));
+    strUsage += HelpMessageOpt("-parcoins=<n>", strprintf(_("Set the number of threads reading the inputs of prefetched blocks from the chainstate database, including the prefetch thread (0 to %d, 0 = only the prefetch thread, default: same as -par)"),
+        MAX_SCRIPTCHECK_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -445,6 +454,8 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
+        strUsage += HelpMessageOpt("-cnsoftwareaes", "Hash Cryptonight with software AES even if the CPU has AES instructions (default: 0)");
+        strUsage += HelpMessageOpt("-cnv4jit", "Compile CryptonightR (variant 4) programs to native code instead of interpreting them (default: 1)");
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-deprecatedrpc=<method>", "Allows deprecated RPC method(s) to be used");
@@ -502,8 +513,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("Block creation options:"));
     strUsage += HelpMessageOpt("-blockmaxweight=<n>", strprintf(_("Set maximum BIP141 block weight (default: %d)"), DEFAULT_BLOCK_MAX_WEIGHT));
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
+    strUsage += HelpMessageOpt("-genthreads=<n>", strprintf(_("Number of threads generate and generatetoaddress mine with, <= 0 to use all cores. More than one thread hashes RandomX on the full dataset, which needs about 2GB of memory (default: %d)"), DEFAULT_GENERATE_THREADS));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
+    strUsage += HelpMessageOpt("-cnjobport=<port>", _("Push Cryptonote mining jobs to clients connecting on <port> (default: disabled)"));
+    strUsage += HelpMessageOpt("-cnjobbind=<addr>", strprintf(_("Bind the Cryptonote job server to <addr> (default: %s)"), DEFAULT_CN_JOB_BIND));
+    strUsage += HelpMessageOpt("-cnjoballowip=<ip>", _("Allow Cryptonote job server clients from specified source, as for -rpcallowip. Only localhost is allowed by default. This option can be specified multiple times"));
 
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
@@ -1000,6 +1015,19 @@ bool AppInitParameterInteraction()
     else
         LogPrintf("Validating signatures for all blocks.\n");
 
+    hashAssumeValidPoW = uint256S(gArgs.GetArg("-assumevalidpow", "0"));
+    nAssumeValidPoWHeight = -1;
+    if (!hashAssumeValidPoW.IsNull()) {
+        for (const auto& checkpoint : chainparams.Checkpoints().mapCheckpoints) {
+            if (checkpoint.second == hashAssumeValidPoW)
+                nAssumeValidPoWHeight = checkpoint.first;
+        }
+        if (nAssumeValidPoWHeight >= 0)
+            LogPrintf("Assuming ancestors of checkpoint %s at height %d have valid proof of work, headers included.\n", hashAssumeValidPoW.GetHex(), nAssumeValidPoWHeight);
+        else
+            LogPrintf("Assuming ancestors of block %s have valid proof of work once its header is known.\n", hashAssumeValidPoW.GetHex());
+    }
+
     if (gArgs.IsArgSet("-minimumchainwork")) {
         const std::string minChainWorkStr = gArgs.GetArg("-minimumchainwork", "");
         if (!IsHexNumber(minChainWorkStr)) {
@@ -1038,6 +1066,19 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // Like -par, -parblock counts the thread calling CheckBlock. Its threads
+    // are not shared with script verification: CheckBlock runs outside
+    // cs_main, at the same time as ConnectBlock verifies scripts, and the two
+    // would wait for each other on a shared queue. They sleep between blocks.
+    nBlockCheckThreads = gArgs.GetArg("-parblock", nScriptCheckThreads);
+    if (nBlockCheckThreads <= 1)
+        nBlockCheckThreads = 0;
+    else if (nBlockCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nBlockCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
+    // Prefetching only pays off when there are cores to spare for it
+    fBlockPrefetch = gArgs.GetBoolArg("-blockprefetch", nScriptCheckThreads != 0);
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1182,6 +1223,15 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    if (gArgs.IsArgSet("-cnsoftwareaes"))
+        crypto::cn_slow_hash_set_software_aes(gArgs.GetBoolArg("-cnsoftwareaes", false));
+    if (gArgs.IsArgSet("-cnv4jit"))
+        crypto::cn_slow_hash_set_v4_jit(gArgs.GetBoolArg("-cnv4jit", true));
+    crypto::slow_hash_info pow_info;
+    crypto::slow_hash_get_info(&pow_info);
+    LogPrintf("Using the '%s' Cryptonight implementation (CryptonightR %s), RandomX with %s AES and %s\n",
+        pow_info.cn_path, pow_info.cn_v4_jit ? "JIT" : "interpreted",
+        pow_info.rx_hw_aes ? "hardware" : "software", pow_info.rx_jit ? "JIT" : "interpreter");
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1251,6 +1301,19 @@ bool AppInitMain()
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
+    if (nBlockCheckThreads) {
+        LogPrintf("Using %u threads for block transaction checks\n", nBlockCheckThreads);
+        for (int i=0; i<nBlockCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadBlockCheck);
+    }
+    if (fBlockPrefetch) {
+        threadGroup.create_thread(&ThreadBlockPrefetch);
+        // Like -par, -parcoins counts the prefetch thread, which reads along
+        const int nCoinsReadThreads = std::min<int>(gArgs.GetArg("-parcoins", nScriptCheckThreads), MAX_SCRIPTCHECK_THREADS);
+        LogPrintf("Using %d threads for prefetching coins\n", std::max(nCoinsReadThreads, 1));
+        for (int i=0; i<nCoinsReadThreads-1; i++)
+            threadGroup.create_thread(&ThreadCoinsRead);
+    }
 
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
@@ -1694,6 +1757,9 @@ bool AppInitMain()
     if (gArgs.GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup, scheduler);
 
+    if (!StartCNJobServer())
+        return false;
+
     Discover(threadGroup);
 
     // Map ports with UPnP
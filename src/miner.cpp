@@ -28,8 +28,12 @@
 #include <validationinterface.h>
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <memory>
+#include <mutex>
 #include <queue>
+#include <thread>
 #include <utility>
 
 //////////////////////////////////////////////////////////////////////////////
@@ -459,3 +463,89 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+static std::mutex cs_rx_dataset_holders;
+static int nRandomXDatasetHolders = 0;
+
+CRandomXDatasetHolder::CRandomXDatasetHolder()
+{
+    std::lock_guard<std::mutex> lock(cs_rx_dataset_holders);
+    ++nRandomXDatasetHolders;
+}
+
+CRandomXDatasetHolder::~CRandomXDatasetHolder()
+{
+    std::lock_guard<std::mutex> lock(cs_rx_dataset_holders);
+    if (--nRandomXDatasetHolders == 0) {
+        // All mining threads have destroyed their VMs by now
+        crypto::rx_stop_mining();
+    }
+}
+
+bool SolveBlock(CBlockHeader& header, const Consensus::Params& consensusParams, uint64_t& nMaxTries, int nThreads)
+{
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(header.nBits, &fNegative, &fOverflow);
+    if (fNegative || bnTarget == 0 || fOverflow || bnTarget > UintToArith256(consensusParams.powLimit))
+        return false;
+
+    // Nonces are handed out in chunks so that threads notice a solution, or
+    // the end of nMaxTries, soon after it happens.
+    static const uint32_t nChunkSize = 256;
+    nThreads = std::max(nThreads, 1);
+    const int nMiners = nThreads > 1 ? nThreads : 0;
+    const uint32_t nRange = (uint32_t)((((uint64_t)1) << 32) / nThreads);
+    const uint32_t nStart = header.cnHeader.nonce;
+
+    std::atomic<int64_t> nTriesLeft((int64_t)std::min<uint64_t>(nMaxTries, std::numeric_limits<int64_t>::max()));
+    std::atomic<bool> fFound(false);
+    uint32_t nFoundNonce = 0;
+
+    auto scan = [&](int nThread) {
+        CBlockHeader work(header);
+        uint32_t nNext = nStart + (uint32_t)nThread * nRange;
+        uint32_t nLeft = nRange;
+        while (nLeft > 0 && !fFound.load(std::memory_order_relaxed)) {
+            int64_t nCount = std::min(nChunkSize, nLeft);
+            const int64_t nAvailable = nTriesLeft.fetch_sub(nCount);
+            if (nAvailable <= 0)
+                break;
+            nCount = std::min(nCount, nAvailable);
+            if (ScanPoWNonces(work, bnTarget, nNext, (uint32_t)nCount, nMiners)) {
+                bool fExpected = false;
+                if (fFound.compare_exchange_strong(fExpected, true))
+                    nFoundNonce = work.cnHeader.nonce;
+                break;
+            }
+            nNext += (uint32_t)nCount;
+            nLeft -= (uint32_t)nCount;
+        }
+    };
+
+    if (nThreads == 1) {
+        scan(0);
+    } else {
+        CRandomXDatasetHolder datasetHolder;
+        std::vector<std::thread> threads;
+        threads.reserve(nThreads);
+        for (int i = 0; i < nThreads; i++) {
+            threads.emplace_back([&scan, i]() {
+                RenameThread("kevacoin-gen");
+                scan(i);
+                // Hashing state is per thread; the RandomX dataset is left
+                // to datasetHolder.
+                crypto::slow_hash_free_state();
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+    nMaxTries = (uint64_t)std::max<int64_t>(nTriesLeft.load(), 0);
+    if (!fFound)
+        return false;
+    header.cnHeader.nonce = nFoundNonce;
+    return true;
+}
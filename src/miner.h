@@ -21,6 +21,8 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -genthreads, the number of threads generate mines with */
+static const int DEFAULT_GENERATE_THREADS = 1;
 
 struct CBlockTemplate
 {
@@ -196,4 +198,29 @@ private:
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
+/**
+ * Keeps the 2GB RandomX dataset used by multi-threaded SolveBlock alive while
+ * any holder exists, and releases it once the last holder goes away. Hold one
+ * across consecutive SolveBlock calls to reuse the dataset between blocks; the
+ * dataset is rebuilt in place when the seed changes.
+ */
+class CRandomXDatasetHolder
+{
+public:
+    CRandomXDatasetHolder();
+    ~CRandomXDatasetHolder();
+    CRandomXDatasetHolder(const CRandomXDatasetHolder&) = delete;
+    CRandomXDatasetHolder& operator=(const CRandomXDatasetHolder&) = delete;
+};
+
+/**
+ * Search for a cnHeader.nonce that solves the block's proof of work, starting
+ * at the current one. The nonce space is split into nThreads contiguous ranges
+ * and each thread scans its own; with more than one thread, RandomX is hashed
+ * on full-dataset VMs, and the dataset is released on return unless a
+ * CRandomXDatasetHolder keeps it. At most nMaxTries nonces are tried, and nMaxTries is
+ * reduced by the number used. Returns true and sets the nonce on success.
+ */
+bool SolveBlock(CBlockHeader& header, const Consensus::Params& consensusParams, uint64_t& nMaxTries, int nThreads);
+
 #endif // BITCOIN_MINER_H
@@ -14,36 +14,184 @@
 #include <validation.h>
 #include <crypto/hash-ops.h>
 
+#include <mutex>
+
 extern "C" void cn_slow_hash(const void *data, size_t length, char *hash, int variant, int prehashed, uint64_t height);
 extern "C" void cn_fast_hash(const void *data, size_t length, char *hash);
 
-static void cn_get_block_hash_by_height(uint64_t seed_height, char cnHash[32])
+static bool cn_get_block_hash_by_height(uint64_t seed_height, char cnHash[32])
 {
-    CBlockIndex* pblockindex = chainActive[seed_height];
+    // Lock-free: the seed height index is kept up to date as headers are
+    // accepted and blocks are connected, so no cs_main is needed here.
+    CBlockIndex* pblockindex = seedHeightIndex.Get(seed_height);
     if (pblockindex == nullptr) {
-        // This will happen during initial block downloading, or when we
-        // are out of sync by more than at least SEEDHASH_EPOCH_BLOCKS blocks.
-        LOCK(cs_main);
-        std::map<uint64_t, CBlockIndex*>::iterator iter = mapBlockSeedHeight.find(seed_height);
-        if (iter != mapBlockSeedHeight.end()) {
-            pblockindex = iter->second;
-        }
-    }
-    if (pblockindex == nullptr) {
-        return;
+        return false;
     }
     uint256 blockHash = pblockindex->GetBlockHash();
     const unsigned char* pHash = blockHash.begin();
     for (int j = 31; j >= 0; j--) {
         cnHash[31 - j] = pHash[j];
     }
+    return true;
+}
+
+static inline unsigned char* WriteCNVarInt(unsigned char* p, uint64_t n)
+{
+    while (n >= 0x80) {
+        *p++ = (unsigned char)((n & 0x7f) | 0x80);
+        n >>= 7;
+    }
+    *p++ = (unsigned char)n;
+    return p;
 }
 
+size_t CryptoNoteHeader::GetBlob(unsigned char* blob) const
+{
+    unsigned char* p = blob;
+    p = WriteCNVarInt(p, major_version);
+    p = WriteCNVarInt(p, minor_version);
+    p = WriteCNVarInt(p, timestamp);
+    memcpy(p, prev_id.begin(), prev_id.size());
+    p += prev_id.size();
+    WriteLE32(p, nonce);
+    p += 4;
+    memcpy(p, merkle_root.begin(), merkle_root.size());
+    p += merkle_root.size();
+    p = WriteCNVarInt(p, nTxes);
+    return p - blob;
+}
+
+size_t CryptoNoteHeader::GetNonceOffset() const
+{
+    unsigned char buf[2 + 2 + 10];
+    unsigned char* p = buf;
+    p = WriteCNVarInt(p, major_version);
+    p = WriteCNVarInt(p, minor_version);
+    p = WriteCNVarInt(p, timestamp);
+    return (p - buf) + prev_id.size();
+}
+
+namespace {
+
+/**
+ * Cache of recently computed header hashes, shared by every copy of a header.
+ * An entry holds the original header it was computed for and, for GetHash(),
+ * the CN header, so a lookup only hits if the header is still the same and
+ * changing any header field needs no bookkeeping. Lookups compare the fields
+ * in place; only a miss serializes the CN header for hashing. The table is
+ * direct-mapped on the original header, which keeps its size fixed, and each
+ * group of slots has its own lock, so that threads hashing different headers
+ * rarely wait for each other.
+ */
+class CHeaderHashCache
+{
+public:
+    bool Get(const CBlockHeader& header, uint256& hashOut)
+    {
+        const unsigned char* vch = (const unsigned char*)BEGIN(header.nVersion);
+        const size_t nSlot = Slot(vch);
+        const Entry& entry = entries[nSlot];
+        std::lock_guard<std::mutex> lock(Lock(nSlot));
+        if (!entry.fHaveHash || memcmp(vch, entry.vchHeader, ORIGINAL_HEADER_SIZE) != 0 || !(entry.cnHeader == header.cnHeader)) {
+            return false;
+        }
+        hashOut = entry.hash;
+        return true;
+    }
+
+    void Set(const CBlockHeader& header, const uint256& hash)
+    {
+        const unsigned char* vch = (const unsigned char*)BEGIN(header.nVersion);
+        const size_t nSlot = Slot(vch);
+        Entry& entry = entries[nSlot];
+        std::lock_guard<std::mutex> lock(Lock(nSlot));
+        entry.Claim(vch);
+        entry.fHaveHash = true;
+        entry.cnHeader = header.cnHeader;
+        entry.hash = hash;
+    }
+
+    bool GetOriginal(const unsigned char* vch, uint256& hashOut)
+    {
+        const size_t nSlot = Slot(vch);
+        const Entry& entry = entries[nSlot];
+        std::lock_guard<std::mutex> lock(Lock(nSlot));
+        if (!entry.fHaveOriginal || memcmp(vch, entry.vchHeader, ORIGINAL_HEADER_SIZE) != 0) {
+            return false;
+        }
+        hashOut = entry.hashOriginal;
+        return true;
+    }
+
+    void SetOriginal(const unsigned char* vch, const uint256& hash)
+    {
+        const size_t nSlot = Slot(vch);
+        Entry& entry = entries[nSlot];
+        std::lock_guard<std::mutex> lock(Lock(nSlot));
+        entry.Claim(vch);
+        entry.fHaveOriginal = true;
+        entry.hashOriginal = hash;
+    }
+
+private:
+    //! Enough for the headers of a full headers message to stay in the cache
+    //! while it is processed.
+    static const int SLOT_BITS = 12;
+    static const int LOCK_BITS = 6;
+
+    struct Entry
+    {
+        unsigned char vchHeader[ORIGINAL_HEADER_SIZE];
+        bool fHaveOriginal = false;
+        uint256 hashOriginal;
+        bool fHaveHash = false;
+        CryptoNoteHeader cnHeader;
+        uint256 hash;
+
+        //! Make this the entry of the given original header, dropping the
+        //! hashes of another one.
+        void Claim(const unsigned char* vch)
+        {
+            if (memcmp(vch, vchHeader, ORIGINAL_HEADER_SIZE) != 0) {
+                memcpy(vchHeader, vch, ORIGINAL_HEADER_SIZE);
+                fHaveOriginal = false;
+                fHaveHash = false;
+            }
+        }
+    };
+
+    //! Spread headers over the table by the previous block hash, the merkle
+    //! root, nTime, nBits and the height in nNonce.
+    static size_t Slot(const unsigned char* vch)
+    {
+        const uint64_t n = ReadLE64(vch + 4) ^ ReadLE64(vch + 36) ^ ReadLE32(vch + 68) ^ ReadLE64(vch + 72);
+        return (n * 0x9E3779B97F4A7C15ULL) >> (64 - SLOT_BITS);
+    }
+
+    std::mutex& Lock(size_t nSlot)
+    {
+        return mutexes[nSlot & ((1 << LOCK_BITS) - 1)];
+    }
+
+    std::mutex mutexes[1 << LOCK_BITS];
+    Entry entries[1 << SLOT_BITS];
+};
+
+CHeaderHashCache headerHashCache;
+
+} // namespace
+
 uint256 CBlockHeader::GetOriginalBlockHash() const
 {
+    uint256 hash;
+    if (headerHashCache.GetOriginal((const unsigned char*)BEGIN(nVersion), hash)) {
+        return hash;
+    }
     CHashWriter hashWriter(SER_GETHASH, PROTOCOL_VERSION);
-    hashWriter.write(BEGIN(nVersion), 80);
-    return hashWriter.GetHash();
+    hashWriter.write(BEGIN(nVersion), ORIGINAL_HEADER_SIZE);
+    hash = hashWriter.GetHash();
+    headerHashCache.SetOriginal((const unsigned char*)BEGIN(nVersion), hash);
+    return hash;
 }
 
 // prev_id of CN header is used to store the kevacoin block hash.
@@ -54,18 +202,40 @@ bool CBlockHeader::isCNConsistent() const
     return (GetOriginalBlockHash() == cnHeader.prev_id);
 }
 
-uint256 CBlockHeader::GetHash() const
+static uint256 ComputeHash(const CBlockHeader& header)
 {
     uint256 thash;
-    if (!isCNConsistent()) {
+    if (!header.isCNConsistent()) {
         memset(thash.begin(), 0xff, thash.size());
+    } else {
+        unsigned char blob[CN_HEADER_MAX_BLOB_SIZE];
+        size_t nBlobSize = header.cnHeader.GetBlob(blob);
+        cn_fast_hash(blob, nBlobSize, BEGIN(thash));
+    }
+    return thash;
+}
+
+uint256 CBlockHeader::GetHash() const
+{
+    uint256 thash;
+    if (headerHashCache.Get(*this, thash)) {
         return thash;
     }
-    cryptonote::blobdata blob = cryptonote::t_serializable_object_to_blob(cnHeader);
-    cn_fast_hash(blob.data(), blob.size(), BEGIN(thash));
+    thash = ComputeHash(*this);
+    headerHashCache.Set(*this, thash);
     return thash;
 }
 
+void CBlockHeader::SetKnownHash(const uint256& hash)
+{
+#ifdef DEBUG
+    // The cache is shared by every copy of this header, so a wrong hash
+    // would be returned for all of them.
+    assert(hash == ComputeHash(*this));
+#endif
+    headerHashCache.Set(*this, hash);
+}
+
 uint256 CBlockHeader::GetPoWHash() const
 {
     uint256 thash;
@@ -73,20 +243,103 @@ uint256 CBlockHeader::GetPoWHash() const
         memset(thash.begin(), 0xff, thash.size());
         return thash;
     }
-    cryptonote::blobdata blob = cryptonote::t_serializable_object_to_blob(cnHeader);
+    unsigned char blob[CN_HEADER_MAX_BLOB_SIZE];
+    size_t nBlobSize = cnHeader.GetBlob(blob);
     uint32_t height = nNonce;
     if (cnHeader.major_version >= RX_BLOCK_VERSION) {
         uint64_t seed_height;
         char cnHash[32];
         seed_height = crypto::rx_seedheight(height);
         cn_get_block_hash_by_height(seed_height, cnHash);
-        crypto::rx_slow_hash(height, seed_height, cnHash, blob.data(), blob.size(), BEGIN(thash), 0, 0);
+        crypto::rx_slow_hash(height, seed_height, cnHash, blob, nBlobSize, BEGIN(thash), 0, 0);
     } else {
-        cn_slow_hash(blob.data(), blob.size(), BEGIN(thash), cnHeader.major_version - 6, 0, height);
+        cn_slow_hash(blob, nBlobSize, BEGIN(thash), cnHeader.major_version - 6, 0, height);
     }
     return thash;
 }
 
+void GetPoWHashes(const std::vector<const CBlockHeader*>& headers, std::vector<uint256>& hashes)
+{
+    hashes.assign(headers.size(), uint256());
+
+    // RandomX headers, grouped by seed height. Each group is hashed on one VM.
+    std::map<uint64_t, std::vector<size_t>> mapSeedGroups;
+    std::vector<unsigned char> vBlobs(headers.size() * CN_HEADER_MAX_BLOB_SIZE);
+    std::vector<size_t> vBlobSizes(headers.size());
+    for (size_t i = 0; i < headers.size(); i++) {
+        const CBlockHeader& header = *headers[i];
+        if (!header.isCNConsistent() || header.cnHeader.major_version < RX_BLOCK_VERSION) {
+            hashes[i] = header.GetPoWHash();
+            continue;
+        }
+        vBlobSizes[i] = header.cnHeader.GetBlob(&vBlobs[i * CN_HEADER_MAX_BLOB_SIZE]);
+        mapSeedGroups[crypto::rx_seedheight(header.nNonce)].push_back(i);
+    }
+
+    for (const auto& group : mapSeedGroups) {
+        const uint64_t seed_height = group.first;
+        const std::vector<size_t>& vIndex = group.second;
+        char cnHash[32];
+        if (!cn_get_block_hash_by_height(seed_height, cnHash)) {
+            // Seed block not accepted yet; leave these for GetPoWHash().
+            continue;
+        }
+        std::vector<const void*> vData(vIndex.size());
+        std::vector<size_t> vLength(vIndex.size());
+        for (size_t j = 0; j < vIndex.size(); j++) {
+            vData[j] = &vBlobs[vIndex[j] * CN_HEADER_MAX_BLOB_SIZE];
+            vLength[j] = vBlobSizes[vIndex[j]];
+        }
+        std::vector<char> vOut(vIndex.size() * crypto::HASH_SIZE);
+        crypto::rx_slow_hash_batch(headers[vIndex[0]]->nNonce, seed_height, cnHash, vData.data(), vLength.data(), vIndex.size(), vOut.data());
+        for (size_t j = 0; j < vIndex.size(); j++) {
+            memcpy(hashes[vIndex[j]].begin(), &vOut[j * crypto::HASH_SIZE], crypto::HASH_SIZE);
+        }
+    }
+}
+
+bool ScanPoWNonces(CBlockHeader& header, const arith_uint256& bnTarget, uint32_t nFirst, uint32_t nCount, int nMiners)
+{
+    if (!header.isCNConsistent()) {
+        return false;
+    }
+    if (header.cnHeader.major_version < RX_BLOCK_VERSION) {
+        for (uint32_t i = 0; i < nCount; i++) {
+            header.cnHeader.nonce = nFirst + i;
+            if (UintToArith256(header.GetPoWHash()) <= bnTarget) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const uint64_t seed_height = crypto::rx_seedheight(header.nNonce);
+    char cnHash[32];
+    if (!cn_get_block_hash_by_height(seed_height, cnHash)) {
+        return false;
+    }
+    unsigned char blob[CN_HEADER_MAX_BLOB_SIZE];
+    const size_t nBlobSize = header.cnHeader.GetBlob(blob);
+    const size_t nNonceOffset = header.cnHeader.GetNonceOffset();
+
+    static const uint32_t SCAN_BATCH_SIZE = 64;
+    char hashes[SCAN_BATCH_SIZE * crypto::HASH_SIZE];
+    for (uint32_t nDone = 0; nDone < nCount; ) {
+        const uint32_t nBatch = std::min(SCAN_BATCH_SIZE, nCount - nDone);
+        crypto::rx_slow_hash_nonces(header.nNonce, seed_height, cnHash, blob, nBlobSize, nNonceOffset, nFirst + nDone, nBatch, hashes, nMiners);
+        for (uint32_t i = 0; i < nBatch; i++) {
+            uint256 hash;
+            memcpy(hash.begin(), &hashes[i * crypto::HASH_SIZE], crypto::HASH_SIZE);
+            if (UintToArith256(hash) <= bnTarget) {
+                header.cnHeader.nonce = nFirst + nDone + i;
+                return true;
+            }
+        }
+        nDone += nBatch;
+    }
+    return false;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
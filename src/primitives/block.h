@@ -12,6 +12,13 @@
 
 #include <cryptonote_basic/cryptonote_format_utils.h>
 
+class arith_uint256;
+
+/** Upper bound of a serialized CryptoNoteHeader, with every varint at its longest. */
+static const size_t CN_HEADER_MAX_BLOB_SIZE = 2 + 2 + 10 + 32 + 4 + 32 + 10;
+/** Size of the original header, nVersion up to nNonce, that GetOriginalBlockHash() hashes. */
+static const size_t ORIGINAL_HEADER_SIZE = 80;
+
 /**
  * This header is to store the proof-of-work of cryptonote mining.
  * Kevacoin uses Cryptonight PoW and uses its existing infrastructure
@@ -49,6 +56,13 @@ public:
         return (timestamp == 0);
     }
 
+    friend bool operator==(const CryptoNoteHeader& a, const CryptoNoteHeader& b)
+    {
+        return a.major_version == b.major_version && a.minor_version == b.minor_version &&
+               a.timestamp == b.timestamp && a.prev_id == b.prev_id && a.nonce == b.nonce &&
+               a.merkle_root == b.merkle_root && a.nTxes == b.nTxes;
+    }
+
     // load
     template <template <bool> class Archive>
     bool do_serialize(Archive<false>& ar)
@@ -85,26 +99,34 @@ public:
       return true;
     }
 
-    ADD_SERIALIZE_METHODS;
+    /**
+     * Serialize into a caller-provided buffer of at least
+     * CN_HEADER_MAX_BLOB_SIZE bytes, without any heap allocation. Produces
+     * the same bytes as cryptonote::t_serializable_object_to_blob(). Returns
+     * the number of bytes written.
+     */
+    size_t GetBlob(unsigned char* blob) const;
+
+    /** Offset of the little-endian nonce in the bytes written by GetBlob(). */
+    size_t GetNonceOffset() const;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const {
+        unsigned char blob[CN_HEADER_MAX_BLOB_SIZE];
+        size_t nSize = GetBlob(blob);
+        WriteCompactSize(s, nSize);
+        s.write((const char*)blob, nSize);
+    }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action) {
-        if (ser_action.ForRead()) {
-            std::string blob;
-            READWRITE(blob);
-            std::stringstream ss;
-            ss << blob;
-            // load
-            binary_archive<false> ba(ss);
-            ::serialization::serialize(ba, *this);
-        } else {
-            std::stringstream ss;
-            // store
-            binary_archive<true> ba(ss);
-            ::serialization::serialize(ba, *this);
-            std::string blob = ss.str();
-            READWRITE(blob);
-        }
+    template <typename Stream>
+    void Unserialize(Stream& s) {
+        std::string blob;
+        s >> blob;
+        std::stringstream ss;
+        ss << blob;
+        // load
+        binary_archive<false> ba(ss);
+        ::serialization::serialize(ba, *this);
     }
 };
 
@@ -186,6 +208,13 @@ public:
 
     bool isCNConsistent() const;
 
+    /**
+     * Seed the header hash cache with an already known GetHash() result, e.g.
+     * the block index key. The caller must be certain it matches this header;
+     * debug builds check it.
+     */
+    void SetKnownHash(const uint256& hash);
+
     bool isLegacy()
     {
         return legacyMode;
@@ -250,6 +279,25 @@ public:
     std::string ToString() const;
 };
 
+/**
+ * Compute the PoW hashes of many headers at once, e.g. a headers message
+ * during initial sync. RandomX headers are grouped by seed and each group is
+ * hashed back-to-back on the calling thread's VM, overlapping one hash with
+ * the next. An entry is left null if its seed block is not known yet, in
+ * which case the caller has to fall back to GetPoWHash().
+ */
+void GetPoWHashes(const std::vector<const CBlockHeader*>& headers, std::vector<uint256>& hashes);
+
+/**
+ * Try cnHeader.nonce values nFirst, nFirst + 1, ... nFirst + nCount - 1 and
+ * stop at the first one whose PoW hash is at or below bnTarget, leaving it in
+ * header.cnHeader.nonce. RandomX nonces are hashed back-to-back on the calling
+ * thread's VM; nMiners > 0 makes that a full-dataset VM, with the shared
+ * dataset built by nMiners threads. Returns false if no nonce in the range
+ * meets the target or the seed block is not known.
+ */
+bool ScanPoWNonces(CBlockHeader& header, const arith_uint256& bnTarget, uint32_t nFirst, uint32_t nCount, int nMiners);
+
 /** Describes a place in the block chain to another node such that if the
  * other node doesn't have the same branch, it can find a recent common trunk.
  * The further back it is, the further before the fork it may be.
@@ -8,10 +8,63 @@
 #include <secp256k1.h>
 #include <secp256k1_recovery.h>
 
+#include <mutex>
+#include <string.h>
+
 namespace
 {
 /* Global secp256k1_context object used for verification. */
 secp256k1_context* secp256k1_context_verify = nullptr;
+
+/**
+ * Public keys as parsed by libsecp256k1, so that a key which signs many
+ * inputs, like the owner of a keva namespace updating it over and over, is
+ * only decompressed once. Slots are picked by the x coordinate and a clash
+ * only costs a parse. They are spread over several locks so that the script
+ * check threads rarely wait for each other.
+ */
+class CParsedPubKeyCache
+{
+private:
+    static const size_t SLOTS = 1024;
+    static const size_t LOCKS = 32;
+
+    struct Slot
+    {
+        unsigned int nSize;
+        unsigned char vch[CPubKey::PUBLIC_KEY_SIZE];
+        secp256k1_pubkey parsed;
+    };
+
+    Slot slots[SLOTS];
+    std::mutex locks[LOCKS];
+
+public:
+    bool Parse(const CPubKey& pubkey, secp256k1_pubkey& parsed)
+    {
+        uint64_t x;
+        memcpy(&x, pubkey.begin() + 1, sizeof(x));
+        const size_t nSlot = x % SLOTS;
+        Slot& slot = slots[nSlot];
+        {
+            std::lock_guard<std::mutex> lock(locks[nSlot % LOCKS]);
+            if (slot.nSize == pubkey.size() && memcmp(slot.vch, pubkey.begin(), pubkey.size()) == 0) {
+                parsed = slot.parsed;
+                return true;
+            }
+        }
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed, pubkey.begin(), pubkey.size())) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(locks[nSlot % LOCKS]);
+        slot.nSize = pubkey.size();
+        memcpy(slot.vch, pubkey.begin(), pubkey.size());
+        slot.parsed = parsed;
+        return true;
+    }
+};
+
+CParsedPubKeyCache parsedPubKeyCache;
 } // namespace
 
 /** This function is taken from the libsecp256k1 distribution and implements
@@ -171,7 +224,7 @@ bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchS
         return false;
     secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, &(*this)[0], size())) {
+    if (!parsedPubKeyCache.Parse(*this, pubkey)) {
         return false;
     }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
@@ -758,7 +758,7 @@ UniValue getlastblockheader(const JSONRPCRequest& request)
     } else {
         blockHeader.push_back(Pair("prev_hash", ""));
     }
-    blockHeader.push_back(Pair("nonce", (uint64_t)pblockindex->cnHeader.nonce));
+    blockHeader.push_back(Pair("nonce", (uint64_t)pblockindex->nCNNonce));
     blockHeader.push_back(Pair("orphan_status", false));
     blockHeader.push_back(Pair("height", (uint64_t)pblockindex->nHeight));
     const uint64_t depth = chainActive.Height() - pblockindex->nHeight + 1; // Same as confirmations.
@@ -841,7 +841,7 @@ UniValue getblockheaderbyheight(const JSONRPCRequest& request)
     } else {
         blockHeader.push_back(Pair("prev_hash", ""));
     }
-    blockHeader.push_back(Pair("nonce", (uint64_t)pblockindex->cnHeader.nonce));
+    blockHeader.push_back(Pair("nonce", (uint64_t)pblockindex->nCNNonce));
     blockHeader.push_back(Pair("orphan_status", false));
     blockHeader.push_back(Pair("height", (uint64_t)pblockindex->nHeight));
     const uint64_t depth = chainActive.Height() - nHeight + 1; // Same as confirmations.
@@ -929,7 +929,7 @@ UniValue getblockheaderbyhash(const JSONRPCRequest& request)
     } else {
         blockHeader.push_back(Pair("prev_hash", ""));
     }
-    blockHeader.push_back(Pair("nonce", (uint64_t)pblockindex->cnHeader.nonce));
+    blockHeader.push_back(Pair("nonce", (uint64_t)pblockindex->nCNNonce));
     blockHeader.push_back(Pair("orphan_status", false));
     blockHeader.push_back(Pair("height", (uint64_t)pblockindex->nHeight));
     const uint64_t depth = chainActive.Height() - pblockindex->nHeight + 1; // Same as confirmations.
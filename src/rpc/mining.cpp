@@ -27,10 +27,13 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <deque>
 #include <memory>
 #include <stdint.h>
+#include <tuple>
 
 #include <cnutils.h>
+#include <common/varint.h>
 #include <string_tools.h>
 #include <cryptonote_core/cryptonote_tx_utils.h>
 #define MAX_RESERVE_SIZE    16
@@ -123,7 +126,12 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
         nHeightEnd = nHeight+nGenerate;
     }
     unsigned int nExtraNonce = 0;
+    int nThreads = gArgs.GetArg("-genthreads", DEFAULT_GENERATE_THREADS);
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
     UniValue blockHashes(UniValue::VARR);
+    // Reuse the RandomX mining dataset across blocks, and free it on return
+    CRandomXDatasetHolder datasetHolder;
     while (nHeight < nHeightEnd)
     {
         std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript));
@@ -135,14 +143,19 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
         pblock->cnHeader.prev_id = pblock->GetOriginalBlockHash();
-        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetPoWHash(), pblock->nBits, Params().GetConsensus())) {
-            ++pblock->cnHeader.nonce;
-            --nMaxTries;
-        }
-        if (nMaxTries == 0) {
-            break;
-        }
-        if (pblock->nNonce == nInnerLoopCount) {
+        // Give up on this template after nInnerLoopCount nonces and retry
+        // with a fresh extranonce.
+        uint64_t nTries = std::min<uint64_t>(nMaxTries, nInnerLoopCount);
+        const uint64_t nTriesBefore = nTries;
+        const bool fSolved = SolveBlock(*pblock, Params().GetConsensus(), nTries, nThreads);
+        nMaxTries -= nTriesBefore - nTries;
+        if (!fSolved) {
+            if (nMaxTries == 0) {
+                break;
+            }
+            if (nTries == nTriesBefore) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Block target out of range");
+            }
             continue;
         }
         std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
@@ -236,6 +249,62 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getpowinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getpowinfo\n"
+            "\nReturns which proof-of-work code paths this node uses on its CPU."
+            "\nResult:\n"
+            "{\n"
+            "  \"major_version\": n,          (numeric) Cryptonote major version of the next block\n"
+            "  \"algorithm\": \"xxxx\",         (string) PoW algorithm of the next block\n"
+            "  \"cryptonight\": {\n"
+            "    \"implementation\": \"xxxx\",  (string) cn_slow_hash implementation\n"
+            "    \"cpu_aes\": true|false,      (boolean) whether the CPU has AES instructions\n"
+            "    \"hardware_aes\": true|false, (boolean) whether they are used\n"
+            "    \"cnr_jit\": true|false       (boolean) whether CryptonightR (variant 4) is compiled to native code\n"
+            "  },\n"
+            "  \"randomx\": {\n"
+            "    \"hardware_aes\": true|false, (boolean) whether RandomX uses AES instructions\n"
+            "    \"jit\": true|false,          (boolean) whether RandomX programs are compiled to native code\n"
+            "    \"argon2\": \"xxxx\"            (string) Argon2 implementation used for the cache (avx2, ssse3 or ref)\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getpowinfo", "")
+            + HelpExampleRpc("getpowinfo", "")
+        );
+
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height() + 1;
+    }
+    const uint8_t nMajorVersion = Params().GetConsensus().GetCryptonoteMajorVersion(nHeight);
+
+    crypto::slow_hash_info info;
+    crypto::slow_hash_get_info(&info);
+
+    UniValue cn(UniValue::VOBJ);
+    cn.push_back(Pair("implementation", info.cn_path));
+    cn.push_back(Pair("cpu_aes", info.cpu_aes != 0));
+    cn.push_back(Pair("hardware_aes", info.cn_hw_aes != 0));
+    cn.push_back(Pair("cnr_jit", info.cn_v4_jit != 0));
+
+    UniValue rx(UniValue::VOBJ);
+    rx.push_back(Pair("hardware_aes", info.rx_hw_aes != 0));
+    rx.push_back(Pair("jit", info.rx_jit != 0));
+    rx.push_back(Pair("argon2", info.rx_argon2_avx2 ? "avx2" : info.rx_argon2_ssse3 ? "ssse3" : "ref"));
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("major_version", (int)nMajorVersion));
+    obj.push_back(Pair("algorithm", nMajorVersion >= RX_BLOCK_VERSION ? std::string("randomx") : strprintf("cryptonight variant %d", nMajorVersion - 6)));
+    obj.push_back(Pair("cryptonight", cn));
+    obj.push_back(Pair("randomx", rx));
+    return obj;
+}
+
 
 // NOTE: Unlike wallet RPC (which use BTC values), mining RPCs follow GBT (BIP 22) in using satoshi amounts
 UniValue prioritisetransaction(const JSONRPCRequest& request)
@@ -347,6 +416,28 @@ std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     return s;
 }
 
+/**
+ * Wait until the best block changes, or until a minute has passed and the
+ * mempool was updated since nTransactionsUpdatedLastLP. Must be called
+ * without cs_main held.
+ */
+static void WaitForNewBlockTemplate(const uint256& hashWatchedChain, unsigned int nTransactionsUpdatedLastLP)
+{
+    std::chrono::steady_clock::time_point checktxtime = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+
+    WaitableLock lock(csBestBlock);
+    while (hashBestBlock == hashWatchedChain && IsRPCRunning())
+    {
+        if (cvBlockChange.wait_until(lock, checktxtime) == std::cv_status::timeout)
+        {
+            // Timeout: Check transactions for update
+            if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                break;
+            checktxtime += std::chrono::seconds(10);
+        }
+    }
+}
+
 UniValue getblocktemplate_original(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 1)
@@ -509,7 +600,6 @@ UniValue getblocktemplate_original(const JSONRPCRequest& request)
     {
         // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
         uint256 hashWatchedChain;
-        std::chrono::steady_clock::time_point checktxtime;
         unsigned int nTransactionsUpdatedLastLP;
 
         if (lpval.isStr())
@@ -529,21 +619,7 @@ UniValue getblocktemplate_original(const JSONRPCRequest& request)
 
         // Release the wallet and main lock while waiting
         LEAVE_CRITICAL_SECTION(cs_main);
-        {
-            checktxtime = std::chrono::steady_clock::now() + std::chrono::minutes(1);
-
-            WaitableLock lock(csBestBlock);
-            while (hashBestBlock == hashWatchedChain && IsRPCRunning())
-            {
-                if (cvBlockChange.wait_until(lock, checktxtime) == std::cv_status::timeout)
-                {
-                    // Timeout: Check transactions for update
-                    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
-                        break;
-                    checktxtime += std::chrono::seconds(10);
-                }
-            }
-        }
+        WaitForNewBlockTemplate(hashWatchedChain, nTransactionsUpdatedLastLP);
         ENTER_CRITICAL_SECTION(cs_main);
 
         if (!IsRPCRunning())
@@ -737,105 +813,224 @@ UniValue getblocktemplate_original(const JSONRPCRequest& request)
     return result;
 }
 
-// Cryptonote RPC API. Not to be confused with the Bitcoin imlementation (see getblocktemplate_original).
-UniValue getblocktemplate(const JSONRPCRequest& request)
+/** A template as it was handed out: its header time and bits at that moment. */
+struct CNServedTemplate
 {
-    // JSON-RPC2 request
-    // {reserve_size: 8, wallet_address: poolAddress}
-    if (request.fHelp || request.params.size() != 2)
-        throw std::runtime_error(
-            "getblocktemplate ( TemplateRequest )\n"
-            "\nThis is a Cryptonote API and is not compatible with original bitcoin implementation (See getblocktemplate_original).\n"
-            "Get a block template on which mining a new block.\n"
-            "\nArguments:\n"
-            "1. reserve_size         (unsigned int) Reserve size\n"
-            "2. wallet_address       (string) Address of wallet to receive coinbase transactions if block is successfully mined.\n"
-            "\nResult:\n"
-            "{\n"
-            "  \"blocktemplate_blob\" : \"xxxx\",   (string) Blob on which to try to mine a new block.\n"
-            "  \"blockhashing_blob\" : \"xxxx\",    (string) Blob on which to try to find a valid nonce.\n"
-            "  \"difficulty\" : n,                (unsigned int) Difficulty of next block.\n"
-            "  \"expected_reward\" : n,           (unsigned int) Coinbase reward expected to be received if block is successfully mined.\n"
-            "  \"height\" : n,                    (unsigned int) maximum allowable input to coinbase transaction, including the generation award and transaction fees (in satoshis)\n"
-            "  \"prev_hash\" : \"xxxx\",            (string) Hash of the most recent block on which to mine the next block.\n"
-            "  \"reserved_offset\" : \"xxxx\",      (unsigned int) Reserved offset.\n"
-            "  \"status\" : \"xxx\",                (string) General RPC error code. \"OK\" means everything looks good.\n"
-            "  \"untrusted\" : n,                 (boolean) States if the result is obtained using the bootstrap mode, and is therefore not trusted (true), or when the daemon is fully synced (false).\n"
-            "}\n"
-            "\nExamples:\n"
-            + HelpExampleCli("getblocktemplate", "8 TGcYLSTvYRy9uaqEZMfs2i1fXdfourYXDb")
-         );
+    std::shared_ptr<const CNBlockTemplate> tmpl;
+    uint32_t nTime;
+    uint32_t nBits;
+};
 
-    int reserve_size;
-    std::string wallet_address;
-    CTxDestination walletDest;
+/** Templates keyed by (reserve_size, wallet address, compact), all built on the same tip and mempool generation. */
+struct CNBlockTemplateCache
+{
+    const CBlockIndex* pindexPrev = nullptr;
+    unsigned int nTransactionsUpdated = 0;
+    int64_t nStart = 0;
+    std::map<std::tuple<int, std::string, bool>, std::shared_ptr<CNBlockTemplate>> mapTemplates;
+    //! Templates served on this tip, keyed by the kevacoin block hash stored in the CN prev_id.
+    std::map<uint256, CNServedTemplate> mapServed;
+    std::deque<uint256> vServedOrder;
+};
 
-    // reserve_size
-    if (request.params[0].getType() != UniValue::VNUM) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "reserve_size must be an integer");
+static CNBlockTemplateCache cnTemplateCache GUARDED_BY(cs_main);
+
+/** Upper bound on cached templates, as every wallet address gets its own. */
+static const size_t MAX_CN_BLOCK_TEMPLATES = 64;
+
+/** Upper bound on served templates remembered for submitblock. */
+static const size_t MAX_CN_SERVED_TEMPLATES = 1024;
+
+/** Offset of nTime within a serialized kevacoin block header. nBits follows it. */
+static const size_t KEVA_HEADER_TIME_OFFSET = 4 + 32 + 32;
+
+static size_t EncodeCNVarInt(uint64_t n, unsigned char* out)
+{
+    unsigned char* p = out;
+    tools::write_varint(p, n);
+    return p - out;
+}
+
+static void PatchBlob(CNBlockTemplate& tmpl, size_t offset, const unsigned char* data, size_t len)
+{
+    static const char hexmap[] = "0123456789abcdef";
+    memcpy(&tmpl.blob[offset], data, len);
+    for (size_t i = 0; i < len; i++) {
+        tmpl.hexBlob[(offset + i) * 2] = hexmap[data[i] >> 4];
+        tmpl.hexBlob[(offset + i) * 2 + 1] = hexmap[data[i] & 15];
     }
+}
 
-    reserve_size = request.params[0].get_int();
-    if (reserve_size <= 0 || reserve_size > MAX_RESERVE_SIZE) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid reserve_size");
+/** Compute the CN header, merkle root and tx count miners hash, as get_block_hashing_blob does. */
+static void UpdateCNHashingBlob(CNBlockTemplate& tmpl)
+{
+    if (!tmpl.fFastSubmit) {
+        return;
     }
+    CryptoNoteHeader header;
+    header.major_version = tmpl.nMajorVersion;
+    header.minor_version = 0;
+    header.timestamp = tmpl.block.GetBlockTime();
+    header.prev_id = tmpl.block.GetOriginalBlockHash();
+    header.nonce = 0;
+    crypto::hash minerTxHash = crypto::cn_fast_hash(tmpl.blob.data() + tmpl.nMinerTxOffset, tmpl.blob.size() - tmpl.nMinerTxOffset - 1);
+    memcpy(header.merkle_root.begin(), &minerTxHash, sizeof(minerTxHash));
+    header.nTxes = 1;
+
+    unsigned char hashingBlob[CN_HEADER_MAX_BLOB_SIZE];
+    const size_t nSize = header.GetBlob(hashingBlob);
+    tmpl.hexHashingBlob = HexStr(hashingBlob, hashingBlob + nSize);
+}
 
-    // wallet_address
-    if (request.params[1].getType() != UniValue::VSTR) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid wallet address, string expected");
+void BuildCNBlockBlob(CNBlockTemplate& tmpl, const Consensus::Params& consensusParams, int reserve_size, bool fCompact)
+{
+    const CBlock& block = tmpl.block;
+    uint256 blockHash = block.GetOriginalBlockHash();
+
+    cryptonote::block cn_block;
+    // block_header
+    cn_block.major_version = consensusParams.GetCryptonoteMajorVersion(block.nNonce);
+    cn_block.minor_version = 0;
+    cn_block.timestamp = block.GetBlockTime();
+    // The prev_id is used to store kevacoin block hash, as a proof of work.
+    memcpy(&(cn_block.prev_id), blockHash.begin(), blockHash.size());
+    cn_block.nonce = 0;
+
+    // block
+    // Coinbase transaction.
+    const size_t    miner_height = 10000;
+    const size_t    median_size = 20000;
+    const uint64_t  already_generated_coins = 10000;
+    const size_t    current_block_size = 20000;
+    const uint64_t  fee = 0;
+    const size_t    max_outs = 10;
+    cryptonote::account_public_address miner_address;
+    cryptonote::address_parse_info parserInfo;
+    cryptonote::transaction miner_tx;
+    cryptonote::blobdata extra_nonce;
+    // The reserve_offset is the offset for extra_nonce
+    extra_nonce.resize(reserve_size, 0);
+
+    if(!cryptonote::get_account_address_from_str(parserInfo, cryptonote::MAINNET, CN_DUMMY_ADDRESS)) {
+      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to parse wallet address");
     }
 
-    wallet_address = request.params[1].get_str();
-    walletDest = DecodeDestination(wallet_address);
-    if (walletDest.which() == 0) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid wallet address");
+    miner_address = parserInfo.address;
+
+    if (!construct_miner_tx(miner_height, median_size, already_generated_coins, current_block_size,
+            fee, miner_address, miner_tx, extra_nonce, max_outs)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to construct miner tx");
     }
+    cn_block.miner_tx = miner_tx;
 
-    LOCK(cs_main);
+    // No transactions other than coinbase.
+    cn_block.tx_hashes.clear();
 
-    std::string strMode = "template";
-    if (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Kevacoin is not connected!");
+    // Copy keva block to extra so that we can use it in submitblock.
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    if (fCompact) {
+        stream << block.nVersion << block.hashPrevBlock << block.hashMerkleRoot << block.nTime << block.nBits << block.nNonce;
+    } else {
+        stream << block;
+    }
+    std::string kevaBlockData = stream.str();
+    cryptonote::tx_extra_keva_block extra_keva_block;
+    extra_keva_block.keva_block = kevaBlockData;
+    if (!cryptonote::append_keva_block_to_extra(cn_block.miner_tx.extra, extra_keva_block)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to add block");
+    }
 
-    if (IsInitialBlockDownload())
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Kevacoin is downloading blocks...");
+    // Now cn_block is finalized, we can calculate the reserved offset position.
+    cryptonote::blobdata block_blob = cryptonote::t_serializable_object_to_blob(cn_block);
 
-    static unsigned int nTransactionsUpdatedLast;
-    bool fSupportsSegwit = true;
+    // Record where the time dependent fields live, so that later calls can
+    // patch them instead of rebuilding the whole blob.
+    unsigned char varint[10];
+    tmpl.nTimestampOffset = EncodeCNVarInt(cn_block.major_version, varint) + EncodeCNVarInt(cn_block.minor_version, varint);
+    tmpl.nTimestampSize = EncodeCNVarInt(cn_block.timestamp, varint);
+    tmpl.nPrevIdOffset = tmpl.nTimestampOffset + tmpl.nTimestampSize;
+    if (block_blob.size() < tmpl.nPrevIdOffset + blockHash.size() ||
+        memcmp(block_blob.data() + tmpl.nPrevIdOffset, blockHash.begin(), blockHash.size()) != 0) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: Failed to locate prev_id in blockblob");
+    }
 
-    // Update block
-    static CBlockIndex* pindexPrev;
-    static int64_t nStart;
-    static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
+    // With a single v1 miner tx and no other transactions the CN merkle root
+    // is the hash of the miner tx bytes, which end right before the empty
+    // tx_hashes vector.
+    tmpl.nMinerTxOffset = tmpl.nPrevIdOffset + blockHash.size() + sizeof(cn_block.nonce);
+
+    // construct_miner_tx puts the tx pub key first in the extra, so its offset
+    // follows from the size of the miner tx fields before the extra, none of
+    // which grow with the kevacoin block. Only search the blob if the layout
+    // is not the expected one.
+    const std::vector<uint8_t>& extra = cn_block.miner_tx.extra;
+    cryptonote::transaction_prefix miner_tx_prefix;
+    miner_tx_prefix.version = cn_block.miner_tx.version;
+    miner_tx_prefix.unlock_time = cn_block.miner_tx.unlock_time;
+    miner_tx_prefix.vin = cn_block.miner_tx.vin;
+    miner_tx_prefix.vout = cn_block.miner_tx.vout;
+    // The serialized prefix ends with the size of its empty extra, a single byte.
+    const size_t nExtraOffset = tmpl.nMinerTxOffset + cryptonote::t_serializable_object_to_blob(miner_tx_prefix).size() - 1 +
+                                EncodeCNVarInt(extra.size(), varint);
+    const size_t nPubKeyFieldSize = 1 + sizeof(crypto::public_key);
+    uint32_t reserved_offset = 0;
+    if (extra.size() >= nPubKeyFieldSize && extra[0] == TX_EXTRA_TAG_PUBKEY &&
+        nExtraOffset + nPubKeyFieldSize <= block_blob.size() &&
+        memcmp(block_blob.data() + nExtraOffset, extra.data(), nPubKeyFieldSize) == 0) {
+        reserved_offset = nExtraOffset + 1;
+    } else {
+        crypto::public_key tx_pub_key = cryptonote::get_tx_pub_key_from_extra(cn_block.miner_tx);
+        if(tx_pub_key == crypto::null_pkey) {
+          throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to tx pub key in coinbase extra");
+        }
+        reserved_offset = slow_memmem((void*)block_blob.data(), block_blob.size(), &tx_pub_key, sizeof(tx_pub_key));
+    }
+    if(!reserved_offset) {
+      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: Failed to find tx pub key in blockblob");
+    }
+    reserved_offset += sizeof(crypto::public_key) + 2; //2 bytes: tag for TX_EXTRA_NONCE(1 byte), counter in TX_EXTRA_NONCE(1 byte)
+    if(reserved_offset + reserve_size > block_blob.size())
     {
-        // Clear pindexPrev so future calls make a new block, despite any failures from here on
-        pindexPrev = nullptr;
-
-        // Store the pindexBest used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
+      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: Failed to calculate offset");
+    }
 
-        // Create new block
-        CScript scriptPubKey = GetScriptForDestination(walletDest);
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptPubKey, fSupportsSegwit);
-        if (!pblocktemplate)
-            throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    // The kevacoin block follows the extra nonce, a few bytes on.
+    const size_t nKevaHeaderSize = ORIGINAL_HEADER_SIZE;
+    auto itKevaHeader = std::search(block_blob.begin() + reserved_offset + reserve_size, block_blob.end(),
+                                    kevaBlockData.begin(), kevaBlockData.begin() + nKevaHeaderSize);
+    if (itKevaHeader == block_blob.end()) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: Failed to locate kevacoin block in blockblob");
+    }
+    tmpl.nKevaHeaderOffset = itKevaHeader - block_blob.begin();
 
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
+    if (block_blob.size() > tmpl.nMinerTxOffset && block_blob.back() == 0) {
+        crypto::hash minerTxHash = crypto::cn_fast_hash(block_blob.data() + tmpl.nMinerTxOffset, block_blob.size() - tmpl.nMinerTxOffset - 1);
+        tmpl.fFastSubmit = minerTxHash == cryptonote::get_tx_tree_hash(cn_block);
     }
-    CBlock* pblock = &pblocktemplate->block; // pointer for convenience
+
+    tmpl.nMajorVersion = cn_block.major_version;
+    tmpl.fCompact = fCompact;
+    tmpl.nReservedOffset = reserved_offset;
+    tmpl.nReserveSize = reserve_size;
+    tmpl.hexBlob = HexStr(block_blob.begin(), block_blob.end());
+    tmpl.blob = std::move(block_blob);
+    UpdateCNHashingBlob(tmpl);
+}
+
+static std::shared_ptr<CNBlockTemplate> CreateCNBlockTemplate(const CBlockIndex* pindexPrev, const CScript& scriptPubKey, int reserve_size, bool fCompact)
+{
+    AssertLockHeld(cs_main);
     const Consensus::Params& consensusParams = Params().GetConsensus();
 
-    // Update nTime
-    UpdateTime(pblock, consensusParams, pindexPrev);
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptPubKey, true);
+    if (!pblocktemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+
+    std::shared_ptr<CNBlockTemplate> tmpl = std::make_shared<CNBlockTemplate>();
+    tmpl->block = pblocktemplate->block;
+    CBlock* pblock = &tmpl->block; // pointer for convenience
 
     std::set<std::string> setClientRules;
-    UniValue aRules(UniValue::VARR);
-    UniValue vbavailable(UniValue::VOBJ);
     for (int j = 0; j < (int)Consensus::MAX_VERSION_BITS_DEPLOYMENTS; ++j) {
         Consensus::DeploymentPos pos = Consensus::DeploymentPos(j);
         ThresholdState state = VersionBitsState(pindexPrev, consensusParams, pos, versionbitscache);
@@ -851,7 +1046,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             case THRESHOLD_STARTED:
             {
                 const struct VBDeploymentInfo& vbinfo = VersionBitsDeploymentInfo[pos];
-                vbavailable.push_back(Pair(gbt_vb_name(pos), consensusParams.vDeployments[pos].bit));
+                tmpl->vbavailable.push_back(Pair(gbt_vb_name(pos), consensusParams.vDeployments[pos].bit));
                 if (setClientRules.find(vbinfo.name) == setClientRules.end()) {
                     if (!vbinfo.gbt_force) {
                         // If the client doesn't support this, don't indicate it in the [default] version
@@ -864,7 +1059,7 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             {
                 // Add to rules only
                 const struct VBDeploymentInfo& vbinfo = VersionBitsDeploymentInfo[pos];
-                aRules.push_back(gbt_vb_name(pos));
+                tmpl->aRules.push_back(gbt_vb_name(pos));
                 if (setClientRules.find(vbinfo.name) == setClientRules.end()) {
                     // Not supported by the client; make sure it's safe to proceed
                     if (!vbinfo.gbt_force) {
@@ -877,99 +1072,254 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
         }
     }
 
+    // Update nTime
+    UpdateTime(pblock, consensusParams, pindexPrev);
+
     // Generate the merkle root as all the transactions (including coinbase) are known.
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
-    uint256 blockHash = pblock->GetOriginalBlockHash();
 
-    cryptonote::block cn_block;
-    // block_header
-    cn_block.major_version = consensusParams.GetCryptonoteMajorVersion(pblock->nNonce);
-    cn_block.minor_version = 0;
-    cn_block.timestamp = pblock->GetBlockTime();
-    // The prev_id is used to store kevacoin block hash, as a proof of work.
-    memcpy(&(cn_block.prev_id), blockHash.begin(), blockHash.size());
-    cn_block.nonce = 0;
+    tmpl->nHeight = pindexPrev->nHeight + 1;
+    BuildCNBlockBlob(*tmpl, consensusParams, reserve_size, fCompact);
 
-    // block
-    // Coinbase transaction.
-    const uint32_t height = pindexPrev->nHeight+1;
-    const size_t    miner_height = 10000;
-    const size_t    median_size = 20000;
-    const uint64_t  already_generated_coins = 10000;
-    const size_t    current_block_size = 20000;
-    const uint64_t  fee = 0;
-    const size_t    max_outs = 10;
-    cryptonote::account_public_address miner_address;
-    cryptonote::address_parse_info parserInfo;
-    cryptonote::transaction miner_tx;
-    cryptonote::blobdata extra_nonce;
-    // The reserve_offset is the offset for extra_nonce
-    extra_nonce.resize(reserve_size, 0);
+    if (tmpl->nMajorVersion >= RX_BLOCK_VERSION) {
+        uint64_t seed_height, next_height;
+        crypto::rx_seedheights(tmpl->nHeight, &seed_height, &next_height);
+        tmpl->hashSeed = chainActive[seed_height]->GetBlockHash();
+        tmpl->hashNextSeed = chainActive[next_height]->GetBlockHash();
+    }
+    return tmpl;
+}
 
-    if(!cryptonote::get_account_address_from_str(parserInfo, cryptonote::MAINNET, CN_DUMMY_ADDRESS)) {
-      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to parse wallet address");
+/**
+ * Bring a cached template up to date with the current time. Returns false if
+ * the blob layout would change, in which case it has to be rebuilt.
+ */
+static bool UpdateCNBlockTemplate(CNBlockTemplate& tmpl, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
+{
+    CBlock& block = tmpl.block;
+    const uint32_t nTimeOld = block.nTime;
+    const uint32_t nBitsOld = block.nBits;
+    UpdateTime(&block, consensusParams, pindexPrev);
+    if (block.nTime == nTimeOld && block.nBits == nBitsOld) {
+        return true;
     }
 
-    miner_address = parserInfo.address;
+    unsigned char timestamp[10];
+    if (EncodeCNVarInt(block.GetBlockTime(), timestamp) != tmpl.nTimestampSize) {
+        return false;
+    }
+    unsigned char timeAndBits[8];
+    WriteLE32(timeAndBits, block.nTime);
+    WriteLE32(timeAndBits + 4, block.nBits);
+    const uint256 blockHash = block.GetOriginalBlockHash();
+
+    PatchBlob(tmpl, tmpl.nTimestampOffset, timestamp, tmpl.nTimestampSize);
+    PatchBlob(tmpl, tmpl.nPrevIdOffset, blockHash.begin(), blockHash.size());
+    PatchBlob(tmpl, tmpl.nKevaHeaderOffset + KEVA_HEADER_TIME_OFFSET, timeAndBits, sizeof(timeAndBits));
+    UpdateCNHashingBlob(tmpl);
+    return true;
+}
 
-    if (!construct_miner_tx(miner_height, median_size, already_generated_coins, current_block_size,
-            fee, miner_address, miner_tx, extra_nonce, max_outs)) {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to construct miner tx");
+// Cryptonote RPC API. Not to be confused with the Bitcoin imlementation (see getblocktemplate_original).
+UniValue getblocktemplate(const JSONRPCRequest& request)
+{
+    // JSON-RPC2 request
+    // {reserve_size: 8, wallet_address: poolAddress}
+    if (request.fHelp || request.params.size() < 2 || request.params.size() > 4)
+        throw std::runtime_error(
+            "getblocktemplate ( TemplateRequest )\n"
+            "\nThis is a Cryptonote API and is not compatible with original bitcoin implementation (See getblocktemplate_original).\n"
+            "Get a block template on which mining a new block.\n"
+            "\nArguments:\n"
+            "1. reserve_size         (unsigned int) Reserve size\n"
+            "2. wallet_address       (string) Address of wallet to receive coinbase transactions if block is successfully mined.\n"
+            "3. longpollid           (string, optional) If given, wait until the template returned with this longpollid is outdated.\n"
+            "4. compact              (boolean, optional, default=false) Only embed the kevacoin block header in the blob. The transactions are fetched with getblocktemplatebody.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocktemplate_blob\" : \"xxxx\",   (string) Blob on which to try to mine a new block.\n"
+            "  \"blockhashing_blob\" : \"xxxx\",    (string) Blob on which to try to find a valid nonce.\n"
+            "  \"difficulty\" : n,                (unsigned int) Difficulty of next block.\n"
+            "  \"target\" : \"xxxx\",               (string) The hash target of the next block.\n"
+            "  \"expected_reward\" : n,           (unsigned int) Coinbase reward expected to be received if block is successfully mined.\n"
+            "  \"height\" : n,                    (unsigned int) maximum allowable input to coinbase transaction, including the generation award and transaction fees (in satoshis)\n"
+            "  \"prev_hash\" : \"xxxx\",            (string) Hash of the most recent block on which to mine the next block.\n"
+            "  \"reserved_offset\" : \"xxxx\",      (unsigned int) Reserved offset.\n"
+            "  \"longpollid\" : \"xxxx\",           (string) Pass back to wait for the next template.\n"
+            "  \"template_id\" : \"xxxx\",          (string) Kevacoin merkle root, identifies the transactions of the template (see getblocktemplatebody).\n"
+            "  \"status\" : \"xxx\",                (string) General RPC error code. \"OK\" means everything looks good.\n"
+            "  \"untrusted\" : n,                 (boolean) States if the result is obtained using the bootstrap mode, and is therefore not trusted (true), or when the daemon is fully synced (false).\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblocktemplate", "8 TGcYLSTvYRy9uaqEZMfs2i1fXdfourYXDb")
+         );
+
+    int reserve_size;
+    std::string wallet_address;
+    CTxDestination walletDest;
+
+    // reserve_size
+    if (request.params[0].getType() != UniValue::VNUM) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "reserve_size must be an integer");
     }
-    cn_block.miner_tx = miner_tx;
 
-    // No transactions other than coinbase.
-    cn_block.tx_hashes.clear();
+    reserve_size = request.params[0].get_int();
+    if (reserve_size <= 0 || reserve_size > MAX_RESERVE_SIZE) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid reserve_size");
+    }
 
-    // Copy keva block to extra so that we can use it in submitblock.
-    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
-    stream << *pblock;
-    std::string kevaBlockData = stream.str();
-    cryptonote::tx_extra_keva_block extra_keva_block;
-    extra_keva_block.keva_block = kevaBlockData;
-    if (!cryptonote::append_keva_block_to_extra(cn_block.miner_tx.extra, extra_keva_block)) {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to add block");
+    // wallet_address
+    if (request.params[1].getType() != UniValue::VSTR) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid wallet address, string expected");
     }
 
-    // Now cn_block is finalized, we can calculate the reserved offset position.
-    cryptonote::blobdata block_blob = cryptonote::t_serializable_object_to_blob(cn_block);
-    crypto::public_key tx_pub_key = cryptonote::get_tx_pub_key_from_extra(cn_block.miner_tx);
-    if(tx_pub_key == crypto::null_pkey) {
-      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: failed to tx pub key in coinbase extra");
+    wallet_address = request.params[1].get_str();
+    walletDest = DecodeDestination(wallet_address);
+    if (walletDest.which() == 0) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid wallet address");
     }
-    uint32_t reserved_offset = slow_memmem((void*)block_blob.data(), block_blob.size(), &tx_pub_key, sizeof(tx_pub_key));
-    if(!reserved_offset) {
-      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: Failed to find tx pub key in blockblob");
+
+    // longpollid
+    if (request.params.size() > 2 && !request.params[2].isNull()) {
+        if (!request.params[2].isStr() || request.params[2].get_str().size() < 64) {
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Invalid longpollid");
+        }
+        // Format: <hashBestChain><nTransactionsUpdatedLast>
+        const std::string lpstr = request.params[2].get_str();
+        uint256 hashWatchedChain;
+        hashWatchedChain.SetHex(lpstr.substr(0, 64));
+        WaitForNewBlockTemplate(hashWatchedChain, atoi64(lpstr.substr(64)));
+        if (!IsRPCRunning())
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Shutting down");
     }
-    reserved_offset += sizeof(tx_pub_key) + 2; //2 bytes: tag for TX_EXTRA_NONCE(1 byte), counter in TX_EXTRA_NONCE(1 byte)
-    if(reserved_offset + reserve_size > block_blob.size())
+
+    // compact
+    bool fCompact = false;
+    if (request.params.size() > 3 && !request.params[3].isNull()) {
+        if (!request.params[3].isBool()) {
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "compact must be a boolean");
+        }
+        fCompact = request.params[3].get_bool();
+    }
+
+    LOCK(cs_main);
+
+    if (g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL) == 0)
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Kevacoin is not connected!");
+
+    if (IsInitialBlockDownload())
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_CORE_BUSY, "Kevacoin is downloading blocks...");
+
+    // Drop all templates once the tip changes, or the mempool did and the
+    // templates are more than 5 seconds old. Served templates remain
+    // submittable until the tip changes.
+    CNBlockTemplateCache& cache = cnTemplateCache;
+    if (cache.pindexPrev != chainActive.Tip()) {
+        cache.mapServed.clear();
+        cache.vServedOrder.clear();
+    }
+    if (cache.pindexPrev != chainActive.Tip() ||
+        (mempool.GetTransactionsUpdated() != cache.nTransactionsUpdated && GetTime() - cache.nStart > 5))
     {
-      throw JSONRPCError(RPC_INTERNAL_ERROR, "Internal error: Failed to calculate offset");
+        cache.mapTemplates.clear();
+        cache.pindexPrev = chainActive.Tip();
+        cache.nTransactionsUpdated = mempool.GetTransactionsUpdated();
+        cache.nStart = GetTime();
+    }
+    const CBlockIndex* pindexPrev = cache.pindexPrev;
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    const std::tuple<int, std::string, bool> key(reserve_size, wallet_address, fCompact);
+    auto it = cache.mapTemplates.find(key);
+    if (it != cache.mapTemplates.end() && !UpdateCNBlockTemplate(*it->second, consensusParams, pindexPrev)) {
+        cache.mapTemplates.erase(it);
+        it = cache.mapTemplates.end();
+    }
+    if (it == cache.mapTemplates.end()) {
+        if (cache.mapTemplates.size() >= MAX_CN_BLOCK_TEMPLATES) {
+            cache.mapTemplates.clear();
+        }
+        std::shared_ptr<CNBlockTemplate> tmpl = CreateCNBlockTemplate(pindexPrev, GetScriptForDestination(walletDest), reserve_size, fCompact);
+        it = cache.mapTemplates.emplace(key, std::move(tmpl)).first;
+    }
+    const CNBlockTemplate& tmpl = *it->second;
+
+    if (tmpl.fFastSubmit) {
+        const uint256 hash = tmpl.block.GetOriginalBlockHash();
+        if (cache.mapServed.emplace(hash, CNServedTemplate{it->second, tmpl.block.nTime, tmpl.block.nBits}).second) {
+            cache.vServedOrder.push_back(hash);
+            if (cache.vServedOrder.size() > MAX_CN_SERVED_TEMPLATES) {
+                cache.mapServed.erase(cache.vServedOrder.front());
+                cache.vServedOrder.pop_front();
+            }
+        }
     }
-    std::string hex_template_blob = HexStr(block_blob.begin(), block_blob.end());
 
     UniValue result(UniValue::VOBJ);
-    const uint64_t difficulty = ConvertNBitsToDiffU64(pblock->nBits);
-    result.push_back(Pair("blocktemplate_blob", hex_template_blob));
+    const uint64_t difficulty = ConvertNBitsToDiffU64(tmpl.block.nBits);
+    result.push_back(Pair("blocktemplate_blob", tmpl.hexBlob));
+    if (!tmpl.hexHashingBlob.empty()) {
+        result.push_back(Pair("blockhashing_blob", tmpl.hexHashingBlob));
+    }
     result.push_back(Pair("difficulty", (double)difficulty));
-    result.push_back(Pair("height", (uint64_t)height));
-    result.push_back(Pair("prev_hash", pblock->hashPrevBlock.GetHex()));    
-    result.push_back(Pair("reserved_offset", (uint64_t)reserved_offset));
-
-    if (cn_block.major_version >= RX_BLOCK_VERSION) {
-        uint64_t seed_height, next_height;
-        crypto::rx_seedheights(height, &seed_height, &next_height);
-        result.push_back(Pair("seed_hash", chainActive[seed_height]->GetBlockHash().GetHex()));
-        result.push_back(Pair("next_seed_hash", chainActive[next_height]->GetBlockHash().GetHex()));
+    result.push_back(Pair("target", arith_uint256().SetCompact(tmpl.block.nBits).GetHex()));
+    result.push_back(Pair("height", (uint64_t)tmpl.nHeight));
+    result.push_back(Pair("prev_hash", tmpl.block.hashPrevBlock.GetHex()));
+    result.push_back(Pair("reserved_offset", (uint64_t)tmpl.nReservedOffset));
+    result.push_back(Pair("longpollid", pindexPrev->GetBlockHash().GetHex() + i64tostr(cache.nTransactionsUpdated)));
+    result.push_back(Pair("template_id", tmpl.block.hashMerkleRoot.GetHex()));
+
+    if (tmpl.nMajorVersion >= RX_BLOCK_VERSION) {
+        result.push_back(Pair("seed_hash", tmpl.hashSeed.GetHex()));
+        result.push_back(Pair("next_seed_hash", tmpl.hashNextSeed.GetHex()));
     }
 
     // Kevacoin specific entries. Not used for now and may be useful in the future.
-    result.push_back(Pair("rules", aRules));
-    result.push_back(Pair("vbavailable", vbavailable));
+    result.push_back(Pair("rules", tmpl.aRules));
+    result.push_back(Pair("vbavailable", tmpl.vbavailable));
 
     return result;
 }
 
+UniValue getblocktemplatebody(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getblocktemplatebody \"template_id\"\n"
+            "\nReturns the transactions of a Cryptonote block template, which compact templates leave out of the blob.\n"
+            "Pools fetch it once per template_id and pass it to submitblock if the node no longer knows the template.\n"
+            "\nArguments:\n"
+            "1. \"template_id\"    (string, required) The template_id returned by getblocktemplate\n"
+            "\nResult:\n"
+            "\"data\"              (string) The hex-encoded transactions, serialized as in a block\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblocktemplatebody", "\"template_id\"")
+         );
+
+    const uint256 id = ParseHashV(request.params[0], "template_id");
+
+    LOCK(cs_main);
+    std::shared_ptr<const CNBlockTemplate> ptmpl;
+    for (const auto& entry : cnTemplateCache.mapTemplates) {
+        if (entry.second->block.hashMerkleRoot == id) {
+            ptmpl = entry.second;
+            break;
+        }
+    }
+    for (auto it = cnTemplateCache.mapServed.begin(); !ptmpl && it != cnTemplateCache.mapServed.end(); ++it) {
+        if (it->second.tmpl->block.hashMerkleRoot == id) {
+            ptmpl = it->second.tmpl;
+        }
+    }
+    if (!ptmpl) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Unknown template_id");
+    }
+
+    CDataStream ssBody(SER_NETWORK, PROTOCOL_VERSION);
+    ssBody << ptmpl->block.vtx;
+    return HexStr(ssBody.begin(), ssBody.end());
+}
+
 class submitblock_StateCatcher : public CValidationInterface
 {
 public:
@@ -994,6 +1344,151 @@ static uint256 CryptoHashToUint256(const crypto::hash& hash)
     return uint256(prev_id);
 }
 
+/**
+ * Fully parse a submitted CN block blob and the kevacoin block embedded in it.
+ * Blobs from compact templates only embed the header; their transactions are
+ * taken from pbody.
+ */
+void DecodeCNBlockBlob(const cryptonote::blobdata& blockblob, const std::vector<unsigned char>* pbody, CBlock& block)
+{
+    cryptonote::block cnblock = AUTO_VAL_INIT(cnblock);
+    if(!cryptonote::parse_and_validate_block_from_blob(blockblob, cnblock)) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Wrong block blob");
+    }
+
+    cryptonote::tx_extra_keva_block keva_block_blob;
+    if (!cryptonote::get_keva_block_from_extra(cnblock.miner_tx.extra, keva_block_blob)) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Could not get Kevacoin block");
+    }
+
+    const std::vector<char> keva_block(keva_block_blob.keva_block.begin(), keva_block_blob.keva_block.end());
+    CDataStream ssBlock(keva_block, SER_NETWORK, PROTOCOL_VERSION);
+    if (keva_block.size() == ORIGINAL_HEADER_SIZE) {
+        if (!pbody) {
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Unknown compact template, block body required");
+        }
+        CDataStream ssBody(*pbody, SER_NETWORK, PROTOCOL_VERSION);
+        try {
+            ssBlock >> block.nVersion >> block.hashPrevBlock >> block.hashMerkleRoot >> block.nTime >> block.nBits >> block.nNonce;
+            ssBody >> block.vtx;
+        }
+        catch (const std::exception&) {
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Failed to deserialize keva block");
+        }
+    } else {
+        try {
+            ssBlock >> block;
+        }
+        catch (const std::exception&) {
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Failed to deserialize keva block");
+        }
+    }
+
+    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase()) {
+        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Block does not start with a coinbase");
+    }
+
+    block.cnHeader.major_version = cnblock.major_version;
+    block.cnHeader.minor_version = cnblock.minor_version;
+    block.cnHeader.timestamp = cnblock.timestamp;
+    block.cnHeader.prev_id = CryptoHashToUint256(cnblock.prev_id);
+
+    block.cnHeader.nonce = cnblock.nonce;
+    crypto::hash tree_root_hash = cryptonote::get_tx_tree_hash(cnblock);
+    block.cnHeader.merkle_root = CryptoHashToUint256(tree_root_hash);
+    block.cnHeader.nTxes = 1; // The Cryptonote coinbase tx.
+}
+
+/** Read the CN header fields before the nonce. Returns false if the blob is too short or malformed. */
+static bool ReadCNBlobHeader(const cryptonote::blobdata& blob, uint64_t& major_version, uint64_t& minor_version, uint64_t& timestamp,
+                             size_t& nTimestampOffset, size_t& nPrevIdOffset)
+{
+    const unsigned char* data = (const unsigned char*)blob.data();
+    const unsigned char* p = data;
+    const unsigned char* pend = data + blob.size();
+    if (tools::read_varint<64>(p, pend, major_version) <= 0 || tools::read_varint<64>(p, pend, minor_version) <= 0) {
+        return false;
+    }
+    nTimestampOffset = p - data;
+    if (tools::read_varint<64>(p, pend, timestamp) <= 0 || pend - p < 32 + 4 || (p[-1] & 0x80)) {
+        return false;
+    }
+    nPrevIdOffset = p - data;
+    return true;
+}
+
+bool GetBlockFromCNTemplate(const CNBlockTemplate& tmpl, uint32_t nTime, uint32_t nBits, const cryptonote::blobdata& blob, CBlock& block)
+{
+    uint64_t major_version, minor_version, timestamp;
+    size_t nTimestampOffset, nPrevIdOffset;
+    if (!tmpl.fFastSubmit || !ReadCNBlobHeader(blob, major_version, minor_version, timestamp, nTimestampOffset, nPrevIdOffset)) {
+        return false;
+    }
+    const unsigned char* data = (const unsigned char*)blob.data();
+    const unsigned char* tmplData = (const unsigned char*)tmpl.blob.data();
+    if (blob.size() != tmpl.blob.size() || nTimestampOffset != tmpl.nTimestampOffset || nPrevIdOffset != tmpl.nPrevIdOffset) {
+        return false;
+    }
+
+    // major_version and minor_version
+    if (memcmp(data, tmplData, tmpl.nTimestampOffset) != 0) {
+        return false;
+    }
+    // miner tx up to the reserved bytes, then up to the kevacoin header
+    // time, which must be the one served, then the rest.
+    const size_t nKevaTimeOffset = tmpl.nKevaHeaderOffset + KEVA_HEADER_TIME_OFFSET;
+    unsigned char timeAndBits[8];
+    WriteLE32(timeAndBits, nTime);
+    WriteLE32(timeAndBits + 4, nBits);
+    const size_t nReservedEnd = tmpl.nReservedOffset + tmpl.nReserveSize;
+    if (memcmp(data + tmpl.nMinerTxOffset, tmplData + tmpl.nMinerTxOffset, tmpl.nReservedOffset - tmpl.nMinerTxOffset) != 0 ||
+        memcmp(data + nReservedEnd, tmplData + nReservedEnd, nKevaTimeOffset - nReservedEnd) != 0 ||
+        memcmp(data + nKevaTimeOffset, timeAndBits, sizeof(timeAndBits)) != 0 ||
+        memcmp(data + nKevaTimeOffset + sizeof(timeAndBits), tmplData + nKevaTimeOffset + sizeof(timeAndBits),
+               blob.size() - nKevaTimeOffset - sizeof(timeAndBits)) != 0) {
+        return false;
+    }
+
+    block = tmpl.block;
+    block.nTime = nTime;
+    block.nBits = nBits;
+    block.cnHeader.major_version = major_version;
+    block.cnHeader.minor_version = minor_version;
+    block.cnHeader.timestamp = timestamp;
+    block.cnHeader.prev_id = uint256(std::vector<unsigned char>(data + nPrevIdOffset, data + nPrevIdOffset + 32));
+    block.cnHeader.nonce = ReadLE32(data + nPrevIdOffset + 32);
+    crypto::hash tree_root_hash = crypto::cn_fast_hash(data + tmpl.nMinerTxOffset, blob.size() - tmpl.nMinerTxOffset - 1);
+    block.cnHeader.merkle_root = CryptoHashToUint256(tree_root_hash);
+    block.cnHeader.nTxes = 1; // The Cryptonote coinbase tx.
+    return true;
+}
+
+/**
+ * Rebuild a submitted block from the getblocktemplate template it was served
+ * from, recognised by the kevacoin block hash in its CN prev_id. Returns
+ * false if the blob does not come from a known template; it then has to be
+ * parsed in full.
+ */
+static bool GetBlockFromServedCNTemplate(const cryptonote::blobdata& blob, CBlock& block)
+{
+    uint64_t major_version, minor_version, timestamp;
+    size_t nTimestampOffset, nPrevIdOffset;
+    if (!ReadCNBlobHeader(blob, major_version, minor_version, timestamp, nTimestampOffset, nPrevIdOffset)) {
+        return false;
+    }
+    const unsigned char* prev_id = (const unsigned char*)blob.data() + nPrevIdOffset;
+
+    // Templates are patched in place by getblocktemplate, so they are only
+    // read under cs_main.
+    LOCK(cs_main);
+    auto it = cnTemplateCache.mapServed.find(uint256(std::vector<unsigned char>(prev_id, prev_id + 32)));
+    if (it == cnTemplateCache.mapServed.end()) {
+        return false;
+    }
+    const CNServedTemplate& served = it->second;
+    return GetBlockFromCNTemplate(*served.tmpl, served.nTime, served.nBits, blob, block);
+}
+
 UniValue submitblock_original(const JSONRPCRequest& request)
 {
     // We allow 2 arguments for compliance with BIP22. Argument 2 is ignored.
@@ -1069,14 +1564,15 @@ UniValue submitblock_original(const JSONRPCRequest& request)
 // Cryptonote RPC call
 UniValue submitblock(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 1) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
         throw std::runtime_error(
-            "submitblock \"hexdata\"\n"
+            "submitblock \"hexdata\" ( \"blockbody\" )\n"
             "\nThis is a Cryptonote API and is not compatible with original bitcoin implementation (See submitblock_original).\n"
             "\nAttempts to submit new block to network.\n"
 
             "\nArguments\n"
             "1. \"hexdata\"        (string, required) the hex-encoded block data to submit\n"
+            "2. \"blockbody\"      (string, optional) the result of getblocktemplatebody, for a compact template the node no longer knows\n"
             "\nResult:\n"
             "\nExamples:\n"
             + HelpExampleCli("submitblock", "\"mydata\"")
@@ -1088,41 +1584,21 @@ UniValue submitblock(const JSONRPCRequest& request)
         throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Wrong block blob");
     }
 
-    cryptonote::block cnblock = AUTO_VAL_INIT(cnblock);
-    if(!cryptonote::parse_and_validate_block_from_blob(blockblob, cnblock)) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Wrong block blob");
-    }
-
-    cryptonote::tx_extra_keva_block keva_block_blob;
-    if (!cryptonote::get_keva_block_from_extra(cnblock.miner_tx.extra, keva_block_blob)) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Could not get Kevacoin block");
+    std::vector<unsigned char> body;
+    const bool fHasBody = request.params.size() > 1 && !request.params[1].isNull();
+    if (fHasBody) {
+        if (!request.params[1].isStr() || !IsHex(request.params[1].get_str())) {
+            throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_PARAM, "Wrong block body");
+        }
+        body = ParseHex(request.params[1].get_str());
     }
 
     std::shared_ptr<CBlock> blockptr = std::make_shared<CBlock>();
     CBlock& block = *blockptr;
-    const std::vector<char> keva_block(keva_block_blob.keva_block.begin(), keva_block_blob.keva_block.end());
-    CDataStream ssBlock(keva_block, SER_NETWORK, PROTOCOL_VERSION);
-    try {
-        ssBlock >> block;
-    }
-    catch (const std::exception&) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Failed to deserialize keva block");
+    if (!GetBlockFromServedCNTemplate(blockblob, block)) {
+        DecodeCNBlockBlob(blockblob, fHasBody ? &body : nullptr, block);
     }
 
-    if (block.vtx.empty() || !block.vtx[0]->IsCoinBase()) {
-        throw CN_JSONRPCError(CORE_RPC_ERROR_CODE_WRONG_BLOCKBLOB, "Block does not start with a coinbase");
-    }
-
-    block.cnHeader.major_version = cnblock.major_version;
-    block.cnHeader.minor_version = cnblock.minor_version;
-    block.cnHeader.timestamp = cnblock.timestamp;
-    block.cnHeader.prev_id = CryptoHashToUint256(cnblock.prev_id);
-
-    block.cnHeader.nonce = cnblock.nonce;
-    crypto::hash tree_root_hash = cryptonote::get_tx_tree_hash(cnblock);
-    block.cnHeader.merkle_root = CryptoHashToUint256(tree_root_hash);
-    block.cnHeader.nTxes = 1; // The Cryptonote coinbase tx.
-
     uint256 hash = block.GetOriginalBlockHash();
     // Cryptonote prev_id is used to store the block hash of kevacoin.
     if (hash != block.cnHeader.prev_id) {
@@ -1379,10 +1855,12 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "mining",             "getnetworkhashps",       &getnetworkhashps,       {"nblocks","height"} },
     { "mining",             "getmininginfo",          &getmininginfo,          {} },
+    { "mining",             "getpowinfo",             &getpowinfo,             {} },
     { "mining",             "prioritisetransaction",  &prioritisetransaction,  {"txid","dummy","fee_delta"} },
-    { "mining",             "getblocktemplate",       &getblocktemplate,       {"reserve_size", "wallet_address"} },
+    { "mining",             "getblocktemplate",       &getblocktemplate,       {"reserve_size", "wallet_address", "longpollid", "compact"} },
     { "mining",             "getblocktemplate_original", &getblocktemplate_original, {"template_request"} },
-    { "mining",             "submitblock",            &submitblock,            {"hexdata","dummy"} },
+    { "mining",             "getblocktemplatebody",   &getblocktemplatebody,   {"template_id"} },
+    { "mining",             "submitblock",            &submitblock,            {"hexdata","blockbody"} },
     { "mining",             "submitblock_original",   &submitblock_original,   {"hexdata","dummy"} },
 
 
@@ -5,14 +5,85 @@
 #ifndef BITCOIN_RPC_MINING_H
 #define BITCOIN_RPC_MINING_H
 
+#include <primitives/block.h>
 #include <script/script.h>
+#include <uint256.h>
 
 #include <univalue.h>
 
+#include <string>
+#include <vector>
+
+namespace Consensus { struct Params; }
+
+/** Address the CN miner tx pays to; the kevacoin coinbase decides the actual payout. */
+extern const std::string CN_DUMMY_ADDRESS;
+
 /** Generate blocks (mine) */
 UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGenerate, uint64_t nMaxTries, bool keepScript);
 
 /** Check bounds on a command line confirm target */
 unsigned int ParseConfirmTarget(const UniValue& value);
 
+/**
+ * A Cryptonote block template as served by getblocktemplate. It is built once
+ * per (tip, mempool generation, reserve_size, wallet address, compact); later
+ * calls only patch the fields that depend on nTime and nBits.
+ *
+ * The miner tx extra carries the kevacoin block for submitblock. In compact
+ * templates it only carries the 80 byte header, and the transactions are
+ * fetched once per template with getblocktemplatebody.
+ */
+struct CNBlockTemplate
+{
+    CBlock block;
+    uint32_t nHeight;
+    uint8_t nMajorVersion;
+    bool fCompact;
+    //! The block blob, and its hex encoding which is patched along with it
+    std::string blob;
+    std::string hexBlob;
+    //! The blob miners hash, empty unless fFastSubmit
+    std::string hexHashingBlob;
+    uint32_t nReservedOffset;
+    uint32_t nReserveSize;
+    //! Byte offsets into the block blob of the fields patched by UpdateCNBlockTemplate
+    size_t nTimestampOffset;
+    size_t nTimestampSize;
+    size_t nPrevIdOffset;
+    size_t nKevaHeaderOffset;
+    //! Start of the miner tx, whose hash is the CN merkle root
+    size_t nMinerTxOffset;
+    //! Whether submitted blobs can be rebuilt from this template (see GetBlockFromCNTemplate)
+    bool fFastSubmit;
+    uint256 hashSeed;
+    uint256 hashNextSeed;
+    UniValue aRules;
+    UniValue vbavailable;
+
+    CNBlockTemplate() : nHeight(0), nMajorVersion(0), fCompact(false), nReservedOffset(0), nReserveSize(0), nTimestampOffset(0), nTimestampSize(0),
+                        nPrevIdOffset(0), nKevaHeaderOffset(0), nMinerTxOffset(0), fFastSubmit(false),
+                        aRules(UniValue::VARR), vbavailable(UniValue::VOBJ) {}
+};
+
+/**
+ * Build the CN block blob of tmpl.block, whose header and transactions must be
+ * final, and record the offsets UpdateCNBlockTemplate patches. Does not touch
+ * the chain state. Throws a JSON-RPC error if the blob cannot be built.
+ */
+void BuildCNBlockBlob(CNBlockTemplate& tmpl, const Consensus::Params& consensusParams, int reserve_size, bool fCompact);
+
+/**
+ * Rebuild a block submitted as a CN block blob from the template it was mined
+ * on, served with nTime and nBits. Apart from the nonce, the CN timestamp and
+ * the reserved bytes the blob must match the template byte for byte, so
+ * neither the CN block nor the embedded kevacoin block has to be
+ * deserialized. Returns false if it does not match, or tmpl is not
+ * fFastSubmit.
+ */
+bool GetBlockFromCNTemplate(const CNBlockTemplate& tmpl, uint32_t nTime, uint32_t nBits, const std::string& blob, CBlock& block);
+
+/** Parse a submitted CN block blob into block. Throws a JSON-RPC error if it is malformed. */
+void DecodeCNBlockBlob(const std::string& blockblob, const std::vector<unsigned char>* pbody, CBlock& block);
+
 #endif
@@ -16,6 +16,7 @@
 #include <rpc/blockchain.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <script/sigcache.h>
 #include <timedata.h>
 #include <util.h>
 #include <utilstrencodings.h>
@@ -610,6 +611,71 @@ UniValue logging(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue SignatureCacheInfo()
+{
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("bytes", (uint64_t)stats.nBytes);
+    obj.pushKV("elements", (uint64_t)stats.nElements);
+    obj.pushKV("hits", stats.nHits);
+    obj.pushKV("misses", stats.nMisses);
+    obj.pushKV("inserts", stats.nInserts);
+    obj.pushKV("evictions", stats.nEvictions);
+    obj.pushKV("generations", stats.nGenerations);
+    return obj;
+}
+
+static const std::string SIGCACHE_INFO_HELP =
+    "{\n"
+    "  \"bytes\": xxxxx,        (numeric) Memory used by the cache table\n"
+    "  \"elements\": xxxxx,     (numeric) Number of signatures the cache can hold\n"
+    "  \"hits\": xxxxx,         (numeric) Signature checks answered from the cache\n"
+    "  \"misses\": xxxxx,       (numeric) Signature checks that had to verify the signature\n"
+    "  \"inserts\": xxxxx,      (numeric) Verified signatures added to the cache\n"
+    "  \"evictions\": xxxxx,    (numeric) Entries dropped because the cache was full\n"
+    "  \"generations\": xxxxx   (numeric) Times the cache aged its entries, old entries are replaced first\n"
+    "}\n";
+
+UniValue getsigcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getsigcacheinfo\n"
+            "Returns the size and the counters of the signature cache. The counters start at zero when the node starts.\n"
+            "\nResult:\n"
+            + SIGCACHE_INFO_HELP +
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+        );
+
+    return SignatureCacheInfo();
+}
+
+UniValue setsigcachesize(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "setsigcachesize size\n"
+            "Resizes the signature cache while the node is running, keeping the cached signatures that fit.\n"
+            "This does not change the script execution cache, which gets the other half of -maxsigcachesize.\n"
+            "\nArguments:\n"
+            "1. size    (numeric, required) The new size in MiB, at most " + std::to_string(MAX_MAX_SIG_CACHE_SIZE) + "\n"
+            "\nResult:\n"
+            + SIGCACHE_INFO_HELP +
+            "\nExamples:\n"
+            + HelpExampleCli("setsigcachesize", "64")
+            + HelpExampleRpc("setsigcachesize", "64")
+        );
+
+    int64_t nSize = request.params[0].get_int64();
+    if (nSize < 0 || nSize > MAX_MAX_SIG_CACHE_SIZE) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("size must be between 0 and %d", MAX_MAX_SIG_CACHE_SIZE));
+    }
+    ResizeSignatureCache((size_t)nSize << 20);
+    return SignatureCacheInfo();
+}
+
 UniValue echo(const JSONRPCRequest& request)
 {
     if (request.fHelp)
@@ -640,6 +706,8 @@ static const CRPCCommand commands[] =
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
+    { "control",            "getsigcacheinfo",        &getsigcacheinfo,        {} },
+    { "control",            "setsigcachesize",        &setsigcachesize,        {"size"} },
     { "util",               "validateaddress",        &validateaddress,        {"address"} }, /* uses wallet if enabled */
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys"} },
     { "util",               "verifymessage",          &verifymessage,          {"address","signature","message"} },
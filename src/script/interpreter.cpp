@@ -32,7 +32,8 @@ inline bool set_error(ScriptError* ret, const ScriptError serror)
 
 } // namespace
 
-bool CastToBool(const valtype& vch)
+template <typename T>
+bool CastToBool(const T& vch)
 {
     for (unsigned int i = 0; i < vch.size(); i++)
     {
@@ -53,13 +54,19 @@ bool CastToBool(const valtype& vch)
  */
 #define stacktop(i)  (stack.at(stack.size()+(i)))
 #define altstacktop(i)  (altstack.at(altstack.size()+(i)))
-static inline void popstack(std::vector<valtype>& stack)
+static inline void popstack(std::vector<StackElement>& stack)
 {
     if (stack.empty())
         throw std::runtime_error("popstack(): stack empty");
     stack.pop_back();
 }
 
+static inline void pushnum(std::vector<StackElement>& stack, const CScriptNum& bn)
+{
+    stack.emplace_back();
+    bn.getvch(stack.back());
+}
+
 bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
     if (vchPubKey.size() < 33) {
         //  Non-canonical public key: too short
@@ -225,46 +232,52 @@ bool static CheckPubKeyEncoding(const valtype &vchPubKey, unsigned int flags, co
     return true;
 }
 
-bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
-    if (data.size() == 0) {
+bool static CheckMinimalPush(const unsigned char* data, size_t size, opcodetype opcode) {
+    if (size == 0) {
         // Could have used OP_0.
         return opcode == OP_0;
-    } else if (data.size() == 1 && data[0] >= 1 && data[0] <= 16) {
+    } else if (size == 1 && data[0] >= 1 && data[0] <= 16) {
         // Could have used OP_1 .. OP_16.
         return opcode == OP_1 + (data[0] - 1);
-    } else if (data.size() == 1 && data[0] == 0x81) {
+    } else if (size == 1 && data[0] == 0x81) {
         // Could have used OP_1NEGATE.
         return opcode == OP_1NEGATE;
-    } else if (data.size() <= 75) {
+    } else if (size <= 75) {
         // Could have used a direct push (opcode indicating number of bytes pushed + those bytes).
-        return opcode == data.size();
-    } else if (data.size() <= 255) {
+        return opcode == size;
+    } else if (size <= 255) {
         // Could have used OP_PUSHDATA.
         return opcode == OP_PUSHDATA1;
-    } else if (data.size() <= 65535) {
+    } else if (size <= 65535) {
         // Could have used OP_PUSHDATA2.
         return opcode == OP_PUSHDATA2;
     }
     return true;
 }
 
-bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
+    return CheckMinimalPush(data.data(), data.size(), opcode);
+}
+
+bool EvalScript(std::vector<StackElement>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
 {
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
     // static const CScriptNum bnFalse(0);
     // static const CScriptNum bnTrue(1);
-    static const valtype vchFalse(0);
-    // static const valtype vchZero(0);
-    static const valtype vchTrue(1, 1);
+    static const StackElement vchFalse;
+    // static const StackElement vchZero;
+    static const StackElement vchTrue(1, (unsigned char)1);
 
     CScript::const_iterator pc = script.begin();
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
     opcodetype opcode;
     valtype vchPushValue;
+    // Signature checkers take byte vectors; these are reused for every check.
+    valtype vchSig, vchPubKey;
     std::vector<bool> vfExec;
-    std::vector<valtype> altstack;
+    std::vector<StackElement> altstack;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if (script.size() > MAX_SCRIPT_SIZE)
         return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
@@ -314,7 +327,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                stack.emplace_back(vchPushValue.begin(), vchPushValue.end());
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -341,7 +354,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // ( -- value)
                     CScriptNum bn((int)opcode - (int)(OP_1 - 1));
-                    stack.push_back(bn.getvch());
+                    pushnum(stack, bn);
                     // The result of these opcodes should always be the minimal way to push the data
                     // they push, so no need for a CheckMinimalPush here.
                 }
@@ -452,7 +465,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     {
                         if (stack.size() < 1)
                             return set_error(serror, SCRIPT_ERR_UNBALANCED_CONDITIONAL);
-                        valtype& vch = stacktop(-1);
+                        StackElement& vch = stacktop(-1);
                         if (sigversion == SIGVERSION_WITNESS_V0 && (flags & SCRIPT_VERIFY_MINIMALIF)) {
                             if (vch.size() > 1)
                                 return set_error(serror, SCRIPT_ERR_MINIMALIF);
@@ -541,8 +554,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-2);
-                    valtype vch2 = stacktop(-1);
+                    StackElement vch1 = stacktop(-2);
+                    StackElement vch2 = stacktop(-1);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
                 }
@@ -553,9 +566,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 -- x1 x2 x3 x1 x2 x3)
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-3);
-                    valtype vch2 = stacktop(-2);
-                    valtype vch3 = stacktop(-1);
+                    StackElement vch1 = stacktop(-3);
+                    StackElement vch2 = stacktop(-2);
+                    StackElement vch3 = stacktop(-1);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
                     stack.push_back(vch3);
@@ -567,8 +580,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 -- x1 x2 x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-4);
-                    valtype vch2 = stacktop(-3);
+                    StackElement vch1 = stacktop(-4);
+                    StackElement vch2 = stacktop(-3);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
                 }
@@ -579,8 +592,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 x5 x6 -- x3 x4 x5 x6 x1 x2)
                     if (stack.size() < 6)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-6);
-                    valtype vch2 = stacktop(-5);
+                    StackElement vch1 = stacktop(-6);
+                    StackElement vch2 = stacktop(-5);
                     stack.erase(stack.end()-6, stack.end()-4);
                     stack.push_back(vch1);
                     stack.push_back(vch2);
@@ -592,8 +605,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 -- x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-4), stacktop(-2));
-                    swap(stacktop(-3), stacktop(-1));
+                    std::swap(stacktop(-4), stacktop(-2));
+                    std::swap(stacktop(-3), stacktop(-1));
                 }
                 break;
 
@@ -602,7 +615,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x - 0 | x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
+                    StackElement vch = stacktop(-1);
                     if (CastToBool(vch))
                         stack.push_back(vch);
                 }
@@ -612,7 +625,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     // -- stacksize
                     CScriptNum bn(stack.size());
-                    stack.push_back(bn.getvch());
+                    pushnum(stack, bn);
                 }
                 break;
 
@@ -630,7 +643,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
+                    StackElement vch = stacktop(-1);
                     stack.push_back(vch);
                 }
                 break;
@@ -649,7 +662,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-2);
+                    StackElement vch = stacktop(-2);
                     stack.push_back(vch);
                 }
                 break;
@@ -665,7 +678,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     popstack(stack);
                     if (n < 0 || n >= (int)stack.size())
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-n-1);
+                    StackElement vch = stacktop(-n-1);
                     if (opcode == OP_ROLL)
                         stack.erase(stack.end()-n-1);
                     stack.push_back(vch);
@@ -679,8 +692,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     //  x2 x3 x1  after second swap
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-3), stacktop(-2));
-                    swap(stacktop(-2), stacktop(-1));
+                    std::swap(stacktop(-3), stacktop(-2));
+                    std::swap(stacktop(-2), stacktop(-1));
                 }
                 break;
 
@@ -689,7 +702,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    swap(stacktop(-2), stacktop(-1));
+                    std::swap(stacktop(-2), stacktop(-1));
                 }
                 break;
 
@@ -698,7 +711,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
+                    StackElement vch = stacktop(-1);
                     stack.insert(stack.end()-2, vch);
                 }
                 break;
@@ -710,7 +723,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     CScriptNum bn(stacktop(-1).size());
-                    stack.push_back(bn.getvch());
+                    pushnum(stack, bn);
                 }
                 break;
 
@@ -725,8 +738,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 - bool)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype& vch1 = stacktop(-2);
-                    valtype& vch2 = stacktop(-1);
+                    StackElement& vch1 = stacktop(-2);
+                    StackElement& vch2 = stacktop(-1);
                     bool fEqual = (vch1 == vch2);
                     // OP_NOTEQUAL is disabled because it would be too easy to say
                     // something like n != 1 and have some wiseguy pass in 1 with extra
@@ -772,7 +785,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     default:            assert(!"invalid opcode"); break;
                     }
                     popstack(stack);
-                    stack.push_back(bn.getvch());
+                    pushnum(stack, bn);
                 }
                 break;
 
@@ -821,7 +834,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     }
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(bn.getvch());
+                    pushnum(stack, bn);
 
                     if (opcode == OP_NUMEQUALVERIFY)
                     {
@@ -862,8 +875,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (in -- hash)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    StackElement& vch = stacktop(-1);
+                    StackElement vchHash;
+                    vchHash.resize((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
                     if (opcode == OP_RIPEMD160)
                         CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
                     else if (opcode == OP_SHA1)
@@ -896,8 +910,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
 
-                    valtype& vchSig    = stacktop(-2);
-                    valtype& vchPubKey = stacktop(-1);
+                    vchSig.assign(stacktop(-2).begin(), stacktop(-2).end());
+                    vchPubKey.assign(stacktop(-1).begin(), stacktop(-1).end());
 
                     // Subset of script starting at the most recent codeseparator
                     CScript scriptCode(pbegincodehash, pend);
@@ -968,7 +982,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // Drop the signature in pre-segwit scripts but not segwit scripts
                     for (int k = 0; k < nSigsCount; k++)
                     {
-                        valtype& vchSig = stacktop(-isig-k);
+                        vchSig.assign(stacktop(-isig-k).begin(), stacktop(-isig-k).end());
                         if (sigversion == SIGVERSION_BASE) {
                             int found = scriptCode.FindAndDelete(CScript(vchSig));
                             if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
@@ -979,8 +993,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     bool fSuccess = true;
                     while (fSuccess && nSigsCount > 0)
                     {
-                        valtype& vchSig    = stacktop(-isig);
-                        valtype& vchPubKey = stacktop(-ikey);
+                        vchSig.assign(stacktop(-isig).begin(), stacktop(-isig).end());
+                        vchPubKey.assign(stacktop(-ikey).begin(), stacktop(-ikey).end());
 
                         // Note how this makes the exact order of pubkey/signature evaluation
                         // distinguishable by CHECKMULTISIG NOT if the STRICTENC flag is set.
@@ -1061,6 +1075,19 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     return set_success(serror);
 }
 
+bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    std::vector<StackElement> evalStack;
+    evalStack.reserve(stack.size());
+    for (const valtype& elem : stack)
+        evalStack.emplace_back(elem.begin(), elem.end());
+    bool ret = EvalScript(evalStack, script, flags, checker, sigversion, serror);
+    stack.clear();
+    for (const StackElement& elem : evalStack)
+        stack.emplace_back(elem.begin(), elem.end());
+    return ret;
+}
+
 namespace {
 
 /**
@@ -1146,7 +1173,14 @@ public:
         // Serialize vin
         unsigned int nInputs = fAnyoneCanPay ? 1 : txTo.vin.size();
         ::WriteCompactSize(s, nInputs);
-        for (unsigned int nInput = 0; nInput < nInputs; nInput++)
+        SerializeTail(s, 0);
+    }
+
+    /** Serialize txTo from input nInputStart onwards */
+    template<typename S>
+    void SerializeTail(S &s, unsigned int nInputStart) const {
+        unsigned int nInputs = fAnyoneCanPay ? 1 : txTo.vin.size();
+        for (unsigned int nInput = nInputStart; nInput < nInputs; nInput++)
              SerializeInput(s, nInput);
         // Serialize vout
         unsigned int nOutputs = fHashNone ? 0 : (fHashSingle ? nIn+1 : txTo.vout.size());
@@ -1192,6 +1226,15 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
         hashSequence = GetSequenceHash(txTo);
         hashOutputs = GetOutputsHash(txTo);
         ready = true;
+    } else if (txTo.vin.size() >= MIN_LEGACY_MIDSTATE_INPUTS) {
+        legacyMidstates.reserve(txTo.vin.size());
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << txTo.nVersion;
+        ::WriteCompactSize(ss, txTo.vin.size());
+        for (const auto& txin : txTo.vin) {
+            legacyMidstates.push_back(ss);
+            ss << txin.prevout << CScript() << txin.nSequence;
+        }
     }
 }
 
@@ -1258,6 +1301,15 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
+    // With SIGHASH_ALL the inputs before nIn are the same for every input
+    // signed, so continue from the precomputed midstate.
+    if (cache && nIn < cache->legacyMidstates.size() && nHashType == SIGHASH_ALL) {
+        CHashWriter ss(cache->legacyMidstates[nIn]);
+        txTmp.SerializeTail(ss, nIn);
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -1372,9 +1424,42 @@ bool TransactionSignatureChecker::CheckSequence(const CScriptNum& nSequence) con
     return true;
 }
 
-static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+/**
+ * Run <vchSig> <vchPubKey> OP_DUP OP_HASH160 <hash> OP_EQUALVERIFY OP_CHECKSIG
+ * without the interpreter, with the same result and error as EvalScript
+ * followed by the check that the script left true on the stack.
+ * scriptCode is the script being executed; for SIGVERSION_BASE the signature
+ * is removed from it as OP_CHECKSIG does.
+ */
+static bool VerifyPubKeyHash(const valtype& vchSig, const valtype& vchPubKey, const unsigned char* hash, CScript scriptCode, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    uint160 hashPubKey;
+    CHash160().Write(vchPubKey.data(), vchPubKey.size()).Finalize(hashPubKey.begin());
+    if (memcmp(hashPubKey.begin(), hash, 20))
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+
+    if (sigversion == SIGVERSION_BASE) {
+        int found = scriptCode.FindAndDelete(CScript(vchSig));
+        if (found > 0 && (flags & SCRIPT_VERIFY_CONST_SCRIPTCODE))
+            return set_error(serror, SCRIPT_ERR_SIG_FINDANDDELETE);
+    }
+
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+        //serror is set
+        return false;
+    }
+    bool fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion);
+
+    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
+        return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+    if (!fSuccess)
+        return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    return set_success(serror);
+}
+
+static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool fTemplates)
 {
-    std::vector<std::vector<unsigned char> > stack;
+    std::vector<valtype>::const_iterator stackEnd;
     CScript scriptPubKey;
 
     if (witversion == 0) {
@@ -1384,7 +1469,7 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WITNESS_EMPTY);
             }
             scriptPubKey = CScript(witness.stack.back().begin(), witness.stack.back().end());
-            stack = std::vector<std::vector<unsigned char> >(witness.stack.begin(), witness.stack.end() - 1);
+            stackEnd = witness.stack.end() - 1;
             uint256 hashScriptPubKey;
             CSHA256().Write(&scriptPubKey[0], scriptPubKey.size()).Finalize(hashScriptPubKey.begin());
             if (memcmp(hashScriptPubKey.begin(), program.data(), 32)) {
@@ -1396,7 +1481,12 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH); // 2 items in witness
             }
             scriptPubKey << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
-            stack = witness.stack;
+            if (fTemplates) {
+                if (witness.stack[0].size() > MAX_SCRIPT_ELEMENT_SIZE || witness.stack[1].size() > MAX_SCRIPT_ELEMENT_SIZE)
+                    return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+                return VerifyPubKeyHash(witness.stack[0], witness.stack[1], program.data(), scriptPubKey, flags, checker, SIGVERSION_WITNESS_V0, serror);
+            }
+            stackEnd = witness.stack.end();
         } else {
             return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WRONG_LENGTH);
         }
@@ -1408,9 +1498,12 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     }
 
     // Disallow stack item size > MAX_SCRIPT_ELEMENT_SIZE in witness stack
-    for (unsigned int i = 0; i < stack.size(); i++) {
-        if (stack.at(i).size() > MAX_SCRIPT_ELEMENT_SIZE)
+    std::vector<StackElement> stack;
+    stack.reserve(stackEnd - witness.stack.begin());
+    for (auto it = witness.stack.begin(); it != stackEnd; ++it) {
+        if (it->size() > MAX_SCRIPT_ELEMENT_SIZE)
             return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+        stack.emplace_back(it->begin(), it->end());
     }
 
     if (!EvalScript(stack, scriptPubKey, flags, checker, SIGVERSION_WITNESS_V0, serror)) {
@@ -1425,7 +1518,142 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     return true;
 }
 
-bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+namespace {
+
+/** A push opcode and the bytes it pushes, pointing into the script. */
+struct ScriptPush
+{
+    opcodetype opcode;
+    const unsigned char* data;
+    unsigned int size;
+};
+
+bool GetScriptPush(const CScript& script, CScript::const_iterator& pc, ScriptPush& push)
+{
+    const CScript::const_iterator start = pc;
+    if (!script.GetOp(pc, push.opcode) || push.opcode > OP_PUSHDATA4)
+        return false;
+    const unsigned int nHeader = push.opcode < OP_PUSHDATA1 ? 1 : push.opcode == OP_PUSHDATA1 ? 2 : push.opcode == OP_PUSHDATA2 ? 3 : 5;
+    push.data = &*start + nHeader;
+    push.size = (pc - start) - nHeader;
+    return true;
+}
+
+/** Whether push is a direct push of 2 to 75 bytes, which is always minimal. */
+bool IsDirectPush(const ScriptPush& push)
+{
+    return push.opcode >= 2 && push.opcode < OP_PUSHDATA1;
+}
+
+/**
+ * Skip the prefix of a keva script as built by CKevaScript, leaving pc at the
+ * address part. Scripts without a keva prefix leave pc at the start. Returns
+ * false for prefixes the interpreter has to handle: other layouts, oversized
+ * arguments and, with SCRIPT_VERIFY_MINIMALDATA, arguments it would reject.
+ */
+bool SkipKevaPrefix(const CScript& script, CScript::const_iterator& pc, unsigned int flags)
+{
+    pc = script.begin();
+    if (script.empty())
+        return true;
+    unsigned int nArgs;
+    switch (script[0]) {
+        case OP_KEVA_PUT: nArgs = 3; break;
+        case OP_KEVA_NAMESPACE:
+        case OP_KEVA_DELETE: nArgs = 2; break;
+        default: return true;
+    }
+    ++pc;
+    for (unsigned int i = 0; i < nArgs; i++) {
+        ScriptPush push;
+        if (!GetScriptPush(script, pc, push) || push.size > MAX_SCRIPT_ELEMENT_SIZE)
+            return false;
+        if ((flags & SCRIPT_VERIFY_MINIMALDATA) && !CheckMinimalPush(push.data, push.size, push.opcode))
+            return false;
+    }
+    opcodetype opcode;
+    if (!script.GetOp(pc, opcode) || opcode != OP_2DROP)
+        return false;
+    if (nArgs == 3 && (!script.GetOp(pc, opcode) || opcode != OP_DROP))
+        return false;
+    return true;
+}
+
+/**
+ * Verify the standard script forms without running EvalScript, optionally
+ * behind a keva prefix:
+ *  - P2PKH spent by <sig> <pubkey>
+ *  - P2WPKH
+ *  - P2SH-wrapped P2WPKH
+ * Every outcome, including the error, is the one the interpreter gives; any
+ * detail the fast path does not model makes it defer to the interpreter.
+ * @return false if the scripts are not handled, otherwise true with the result in fResult
+ */
+bool VerifyStandardScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool& fResult)
+{
+    if (scriptPubKey.size() > MAX_SCRIPT_SIZE)
+        return false;
+    CScript::const_iterator pc = scriptPubKey.begin();
+    if (!SkipKevaPrefix(scriptPubKey, pc, flags))
+        return false;
+    const bool fKeva = pc != scriptPubKey.begin();
+    const size_t nAddressSize = scriptPubKey.end() - pc;
+
+    if (nAddressSize == 25 && pc[0] == OP_DUP && pc[1] == OP_HASH160 && pc[2] == 0x14 && pc[23] == OP_EQUALVERIFY && pc[24] == OP_CHECKSIG) {
+        // P2PKH: the scriptSig must be exactly <sig> <pubkey>
+        CScript::const_iterator pcSig = scriptSig.begin();
+        ScriptPush sig, pubkey;
+        if (!GetScriptPush(scriptSig, pcSig, sig) || !IsDirectPush(sig) ||
+            !GetScriptPush(scriptSig, pcSig, pubkey) || !IsDirectPush(pubkey) || pcSig != scriptSig.end()) {
+            return false;
+        }
+        // Leave unexpected witness data to the interpreter
+        if (!witness.IsNull())
+            return false;
+        const valtype vchSig(sig.data, sig.data + sig.size);
+        const valtype vchPubKey(pubkey.data, pubkey.data + pubkey.size);
+        fResult = VerifyPubKeyHash(vchSig, vchPubKey, &pc[3], scriptPubKey, flags, checker, SIGVERSION_BASE, serror);
+        return true;
+    }
+
+    const unsigned int nWitnessFlags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS;
+    if ((flags & nWitnessFlags) != nWitnessFlags)
+        return false;
+
+    if (!fKeva && nAddressSize == 22 && pc[0] == OP_0 && pc[1] == 0x14) {
+        // P2WPKH: the scriptSig must be empty
+        if (!scriptSig.empty())
+            return false;
+        const valtype program(pc + 2, scriptPubKey.end());
+        if (!CastToBool(program))
+            return false;
+        fResult = VerifyWitnessProgram(witness, 0, program, flags, checker, serror, true);
+        return true;
+    }
+
+    if (nAddressSize == 23 && pc[0] == OP_HASH160 && pc[1] == 0x14 && pc[22] == OP_EQUAL) {
+        // P2SH-P2WPKH: the scriptSig must be exactly a push of OP_0 <20 bytes>
+        if (scriptSig.size() != 23 || scriptSig[0] != 22 || scriptSig[1] != OP_0 || scriptSig[2] != 0x14)
+            return false;
+        uint160 hashRedeemScript;
+        CHash160().Write(&scriptSig[1], 22).Finalize(hashRedeemScript.begin());
+        if (memcmp(hashRedeemScript.begin(), &pc[2], 20)) {
+            fResult = set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+            return true;
+        }
+        const valtype program(scriptSig.begin() + 3, scriptSig.end());
+        if (!CastToBool(program))
+            return false;
+        fResult = VerifyWitnessProgram(witness, 0, program, flags, checker, serror, true);
+        return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+static bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool fTemplates)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
@@ -1439,7 +1667,12 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
-    std::vector<std::vector<unsigned char> > stack, stackCopy;
+    bool fResult;
+    if (fTemplates && VerifyStandardScript(scriptSig, scriptPubKey, *witness, flags, checker, serror, fResult)) {
+        return fResult;
+    }
+
+    std::vector<StackElement> stack, stackCopy;
     if (!EvalScript(stack, scriptSig, flags, checker, SIGVERSION_BASE, serror))
         // serror is set
         return false;
@@ -1464,7 +1697,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
                 // The scriptSig must be _exactly_ CScript(), otherwise we reintroduce malleability.
                 return set_error(serror, SCRIPT_ERR_WITNESS_MALLEATED);
             }
-            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror)) {
+            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, fTemplates)) {
                 return false;
             }
             // Bypass the cleanstack check at the end. The actual stack is obviously not clean
@@ -1488,8 +1721,8 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         // an empty stack and the EvalScript above would return false.
         assert(!stack.empty());
 
-        const valtype& pubKeySerialized = stack.back();
-        CScript pubKey2(pubKeySerialized.begin(), pubKeySerialized.end());
+        const StackElement& pubKeySerialized = stack.back();
+        CScript pubKey2(pubKeySerialized.data(), pubKeySerialized.data() + pubKeySerialized.size());
         popstack(stack);
 
         if (!EvalScript(stack, pubKey2, flags, checker, SIGVERSION_BASE, serror))
@@ -1509,7 +1742,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
                     // reintroduce malleability.
                     return set_error(serror, SCRIPT_ERR_WITNESS_MALLEATED_P2SH);
                 }
-                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror)) {
+                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, fTemplates)) {
                     return false;
                 }
                 // Bypass the cleanstack check at the end. The actual stack is obviously not clean
@@ -1545,6 +1778,16 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
     return set_success(serror);
 }
 
+bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    return VerifyScript(scriptSig, scriptPubKey, witness, flags, checker, serror, true);
+}
+
+bool VerifyScriptInterpreted(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    return VerifyScript(scriptSig, scriptPubKey, witness, flags, checker, serror, false);
+}
+
 size_t static WitnessSigOps(int witversion, const std::vector<unsigned char>& witprogram, const CScriptWitness& witness, int flags)
 {
     if (witversion == 0) {
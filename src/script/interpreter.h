@@ -6,6 +6,8 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <hash.h>
+#include <prevector.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
 
@@ -123,10 +125,23 @@ enum
 
 bool CheckSignatureEncoding(const std::vector<unsigned char> &vchSig, unsigned int flags, ScriptError* serror);
 
+/** Non-witness transactions with at least this many inputs get legacy sighash midstates. */
+static const unsigned int MIN_LEGACY_MIDSTATE_INPUTS = 16;
+
 struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs;
     bool ready = false;
+    /**
+     * Legacy SIGHASH_ALL midstates. Entry i has hashed nVersion, the input
+     * count and inputs 0..i-1 with their scriptSigs blanked, which is the
+     * prefix shared by the signature hashes of input i and every input after
+     * it. The signature hash of input i resumes from entry i instead of
+     * hashing that prefix again. The inputs after i and the outputs are still
+     * hashed for every input, so this roughly halves the work of checking
+     * all inputs rather than making it linear.
+     */
+    std::vector<CHashWriter> legacyMidstates;
 
     explicit PrecomputedTransactionData(const CTransaction& tx);
 };
@@ -188,8 +203,19 @@ public:
     MutableTransactionSignatureChecker(const CMutableTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn) : TransactionSignatureChecker(&txTo, nInIn, amountIn), txTo(*txToIn) {}
 };
 
+/**
+ * An element of the interpreter stack. Elements of up to 75 bytes, the
+ * largest direct push, are stored inline, so that signatures, public keys,
+ * hashes and numbers do not need a heap allocation.
+ */
+typedef prevector<75, unsigned char> StackElement;
+
+bool EvalScript(std::vector<StackElement>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = nullptr);
+/** EvalScript on a stack of byte vectors, for callers that inspect or build stacks. */
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = nullptr);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
+/** VerifyScript without the fast paths for standard scripts, always running EvalScript. For tests and benchmarks. */
+bool VerifyScriptInterpreted(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
 
 size_t CountWitnessSigOps(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags);
 
@@ -227,7 +227,9 @@ public:
 
     static const size_t nDefaultMaxNumSize = 4;
 
-    explicit CScriptNum(const std::vector<unsigned char>& vch, bool fRequireMinimal,
+    /** Parse a byte vector, or another byte container such as an interpreter stack element. */
+    template <typename T>
+    explicit CScriptNum(const T& vch, bool fRequireMinimal,
                         const size_t nMaxNumSize = nDefaultMaxNumSize)
     {
         if (vch.size() > nMaxNumSize) {
@@ -329,12 +331,26 @@ public:
         return serialize(m_value);
     }
 
+    /** Append the serialization to an empty byte container, such as an interpreter stack element. */
+    template <typename T>
+    void getvch(T& result) const
+    {
+        serialize(m_value, result);
+    }
+
     static std::vector<unsigned char> serialize(const int64_t& value)
+    {
+        std::vector<unsigned char> result;
+        serialize(value, result);
+        return result;
+    }
+
+    template <typename T>
+    static void serialize(const int64_t& value, T& result)
     {
         if(value == 0)
-            return std::vector<unsigned char>();
+            return;
 
-        std::vector<unsigned char> result;
         const bool neg = value < 0;
         uint64_t absvalue = neg ? -value : value;
 
@@ -358,12 +374,11 @@ public:
             result.push_back(neg ? 0x80 : 0);
         else if (neg)
             result.back() |= 0x80;
-
-        return result;
     }
 
 private:
-    static int64_t set_vch(const std::vector<unsigned char>& vch)
+    template <typename T>
+    static int64_t set_vch(const T& vch)
     {
       if (vch.empty())
           return 0;
@@ -12,6 +12,9 @@
 #include <util.h>
 
 #include <cuckoocache.h>
+
+#include <atomic>
+
 #include <boost/thread.hpp>
 
 namespace {
@@ -29,6 +32,11 @@ private:
     map_type setValid;
     boost::shared_mutex cs_sigcache;
 
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+    std::atomic<uint64_t> nInserts{0};
+    std::atomic<uint64_t> nEvictions{0};
+
 public:
     CSignatureCache()
     {
@@ -44,19 +52,58 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        bool fFound;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            fFound = setValid.contains(entry, erase);
+        }
+        (fFound ? nHits : nMisses).fetch_add(1, std::memory_order_relaxed);
+        return fFound;
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        bool fKept;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+            fKept = setValid.insert(entry);
+        }
+        nInserts.fetch_add(1, std::memory_order_relaxed);
+        if (!fKept)
+            nEvictions.fetch_add(1, std::memory_order_relaxed);
     }
     uint32_t setup_bytes(size_t n)
     {
         return setValid.setup_bytes(n);
     }
+
+    uint32_t resize_bytes(size_t n)
+    {
+        uint32_t nDropped;
+        uint32_t nElems;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+            nElems = setValid.resize_bytes(n, &nDropped);
+        }
+        nEvictions.fetch_add(nDropped, std::memory_order_relaxed);
+        return nElems;
+    }
+
+    SignatureCacheStats GetStats()
+    {
+        SignatureCacheStats stats;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+            stats.nElements = setValid.capacity();
+            stats.nGenerations = setValid.generations();
+        }
+        stats.nBytes = stats.nElements * sizeof(uint256);
+        stats.nHits = nHits.load(std::memory_order_relaxed);
+        stats.nMisses = nMisses.load(std::memory_order_relaxed);
+        stats.nInserts = nInserts.load(std::memory_order_relaxed);
+        stats.nEvictions = nEvictions.load(std::memory_order_relaxed);
+        return stats;
+    }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -80,6 +127,19 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+uint32_t ResizeSignatureCache(size_t nBytes)
+{
+    size_t nElems = signatureCache.resize_bytes(nBytes);
+    LogPrintf("Resized signature cache to %zu MiB, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nElems);
+    return nElems;
+}
+
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
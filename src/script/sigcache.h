@@ -46,11 +46,27 @@ private:
     bool store;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, const PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn) {}
 
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
 void InitSignatureCache();
 
+/** Resize the signature cache to nBytes, keeping the entries that fit. Returns the number of elements it can store. */
+uint32_t ResizeSignatureCache(size_t nBytes);
+
+struct SignatureCacheStats
+{
+    size_t nBytes;          //!< Memory used by the table
+    uint32_t nElements;     //!< Number of elements the table can store
+    uint64_t nHits;         //!< Lookups that found a valid signature
+    uint64_t nMisses;       //!< Lookups that had to verify the signature
+    uint64_t nInserts;      //!< Verified signatures stored in the cache
+    uint64_t nEvictions;    //!< Entries dropped because the table was full
+    uint64_t nGenerations;  //!< Times the cache aged its entries by one generation
+};
+
+SignatureCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -0,0 +1,114 @@
+// Copyright (c) 2018 the Kevacoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SEEDHEIGHTINDEX_H
+#define BITCOIN_SEEDHEIGHTINDEX_H
+
+#include <atomic>
+#include <limits>
+#include <stddef.h>
+#include <stdint.h>
+
+class CBlockIndex;
+
+/**
+ * Block index entries at RandomX seed heights, indexed directly by seed epoch.
+ * Written with cs_main held as headers are accepted and blocks connected, and
+ * read without any lock by PoW hashing. Storage grows in fixed chunks that are
+ * never moved or freed while in use, so a reader can never see a dangling
+ * slot. A reader that races a writer simply sees the old entry or none.
+ */
+class CSeedHeightIndex
+{
+public:
+    //! Must match SEEDHASH_EPOCH_BLOCKS in rx-slow-hash.c
+    static const uint64_t EPOCH_BLOCKS = 2048;
+    static const size_t CHUNK_SIZE = 1024;
+    //! Enough chunks to cover every height representable in a CBlockIndex.
+    static const size_t MAX_CHUNKS = ((uint64_t)std::numeric_limits<int>::max() / EPOCH_BLOCKS) / CHUNK_SIZE + 1;
+
+    CSeedHeightIndex()
+    {
+        for (auto& chunk : vChunks) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~CSeedHeightIndex()
+    {
+        for (auto& chunk : vChunks) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    CSeedHeightIndex(const CSeedHeightIndex&) = delete;
+    CSeedHeightIndex& operator=(const CSeedHeightIndex&) = delete;
+
+    //! Lock-free lookup; nullptr if no block is known at this seed height.
+    CBlockIndex* Get(uint64_t seed_height) const
+    {
+        std::atomic<CBlockIndex*>* slot = Slot(seed_height, false);
+        return slot ? slot->load(std::memory_order_acquire) : nullptr;
+    }
+
+    //! Record pindex unless this seed height already has an entry.
+    void Add(uint64_t seed_height, CBlockIndex* pindex)
+    {
+        std::atomic<CBlockIndex*>* slot = Slot(seed_height, true);
+        if (slot && slot->load(std::memory_order_relaxed) == nullptr) {
+            slot->store(pindex, std::memory_order_release);
+        }
+    }
+
+    //! Record pindex, replacing any entry (the active chain takes precedence).
+    void Set(uint64_t seed_height, CBlockIndex* pindex)
+    {
+        std::atomic<CBlockIndex*>* slot = Slot(seed_height, true);
+        if (slot) {
+            slot->store(pindex, std::memory_order_release);
+        }
+    }
+
+    //! Drop all entries. Chunks are kept, as lock-free readers may hold them.
+    void Clear()
+    {
+        for (auto& chunk : vChunks) {
+            std::atomic<CBlockIndex*>* entries = chunk.load(std::memory_order_relaxed);
+            if (entries) {
+                for (size_t i = 0; i < CHUNK_SIZE; i++) {
+                    entries[i].store(nullptr, std::memory_order_release);
+                }
+            }
+        }
+    }
+
+private:
+    std::atomic<CBlockIndex*>* Slot(uint64_t seed_height, bool fCreate) const
+    {
+        if (seed_height % EPOCH_BLOCKS != 0) {
+            return nullptr;
+        }
+        const uint64_t nEpoch = seed_height / EPOCH_BLOCKS;
+        if (nEpoch / CHUNK_SIZE >= MAX_CHUNKS) {
+            return nullptr;
+        }
+        std::atomic<std::atomic<CBlockIndex*>*>& chunk = vChunks[nEpoch / CHUNK_SIZE];
+        std::atomic<CBlockIndex*>* entries = chunk.load(std::memory_order_acquire);
+        if (entries == nullptr && fCreate) {
+            // Only writers (holding cs_main) create chunks.
+            entries = new std::atomic<CBlockIndex*>[CHUNK_SIZE];
+            for (size_t i = 0; i < CHUNK_SIZE; i++) {
+                entries[i].store(nullptr, std::memory_order_relaxed);
+            }
+            chunk.store(entries, std::memory_order_release);
+        }
+        return entries ? &entries[nEpoch % CHUNK_SIZE] : nullptr;
+    }
+
+    mutable std::atomic<std::atomic<CBlockIndex*>*> vChunks[MAX_CHUNKS];
+};
+
+extern CSeedHeightIndex& seedHeightIndex;
+
+#endif // BITCOIN_SEEDHEIGHTINDEX_H
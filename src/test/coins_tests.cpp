@@ -855,4 +855,32 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_cachecoins)
+{
+    // CacheCoins only fills outpoints the cache does not know about yet and
+    // leaves them clean, so a later flush does not write them back.
+    CCoinsView root;
+    CCoinsViewCacheTest cache{&root};
+    cache.usage() += InsertCoinsMapEntry(cache.map(), VALUE1, DIRTY);
+
+    std::vector<COutPoint> vOutpoints{OUTPOINT, COutPoint(OUTPOINT.hash, 1), COutPoint(OUTPOINT.hash, 2)};
+    std::vector<Coin> vCoins(3);
+    SetCoinsValue(VALUE2, vCoins[0]);
+    SetCoinsValue(VALUE3, vCoins[1]);
+    cache.CacheCoins(vOutpoints, vCoins);
+    cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, VALUE1);
+    BOOST_CHECK_EQUAL(result_flags, DIRTY);
+
+    auto it = cache.map().find(vOutpoints[1]);
+    BOOST_CHECK(it != cache.map().end());
+    BOOST_CHECK_EQUAL(it->second.coin.out.nValue, VALUE3);
+    BOOST_CHECK_EQUAL(it->second.flags, 0);
+    BOOST_CHECK(cache.map().find(vOutpoints[2]) == cache.map().end());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
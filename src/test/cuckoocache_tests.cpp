@@ -377,4 +377,56 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** This helper checks that resizing keeps the live elements: all of them when
+ * growing, and none of the erased ones either way */
+template <typename Cache>
+void test_cache_resize(size_t megabytes)
+{
+    local_rand_ctx = FastRandomContext(true);
+    Cache set{};
+    size_t bytes = megabytes * (1 << 20);
+    set.setup_bytes(bytes);
+    // Fill half of the cache so that no insert runs out of depth
+    uint32_t n_insert = static_cast<uint32_t>(bytes / sizeof(uint256)) / 2;
+    std::vector<uint256> hashes(n_insert);
+    for (uint32_t i = 0; i < n_insert; ++i)
+        insecure_GetRandHash(hashes[i]);
+    for (uint32_t i = 0; i < n_insert; ++i)
+        BOOST_CHECK(set.insert(hashes[i]));
+    /** Erase the first quarter */
+    for (uint32_t i = 0; i < n_insert / 4; ++i)
+        set.contains(hashes[i], true);
+
+    uint32_t dropped;
+    uint32_t n_resized = set.resize_bytes(2 * bytes, &dropped);
+    BOOST_CHECK_EQUAL(n_resized, set.capacity());
+    BOOST_CHECK_EQUAL(set.capacity(), 2 * bytes / sizeof(uint256));
+    BOOST_CHECK_EQUAL(dropped, 0U);
+    for (uint32_t i = 0; i < n_insert / 4; ++i)
+        BOOST_CHECK(!set.contains(hashes[i], false));
+    for (uint32_t i = n_insert / 4; i < n_insert; ++i)
+        BOOST_CHECK(set.contains(hashes[i], false));
+
+    /** Shrinking to a quarter of the original size cannot keep all the live elements */
+    set.resize_bytes(bytes / 4, &dropped);
+    size_t count_kept = 0;
+    for (uint32_t i = n_insert / 4; i < n_insert; ++i)
+        count_kept += set.contains(hashes[i], false);
+    BOOST_CHECK_EQUAL(count_kept + dropped, n_insert - n_insert / 4);
+    BOOST_CHECK(count_kept <= set.capacity());
+    BOOST_CHECK(count_kept > set.capacity() / 2);
+
+    /** The cache keeps working after a resize */
+    uint256 v;
+    insecure_GetRandHash(v);
+    set.insert(v);
+    BOOST_CHECK(set.contains(v, false));
+}
+
+BOOST_AUTO_TEST_CASE(cuckoocache_resize)
+{
+    size_t megabytes = 4;
+    test_cache_resize<CuckooCache::cache<uint256, SignatureCacheHasher>>(megabytes);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
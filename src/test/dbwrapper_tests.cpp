@@ -42,6 +42,29 @@ BOOST_AUTO_TEST_CASE(dbwrapper)
     }
 }
 
+// Reads from a snapshot do not see later writes
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+    char key = 'k';
+    char key2 = 'l';
+    uint256 in = InsecureRand256();
+    uint256 in2 = InsecureRand256();
+    uint256 res;
+
+    BOOST_CHECK(dbw.Write(key, in));
+    std::shared_ptr<const leveldb::Snapshot> snapshot = dbw.GetSnapshot();
+    BOOST_CHECK(dbw.Write(key, in2));
+    BOOST_CHECK(dbw.Write(key2, in2));
+
+    BOOST_CHECK(dbw.Read(key, res, snapshot.get()));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    BOOST_CHECK(!dbw.Read(key2, res, snapshot.get()));
+    BOOST_CHECK(dbw.Read(key, res, nullptr));
+    BOOST_CHECK_EQUAL(res.ToString(), in2.ToString());
+}
+
 // Test batch operations
 BOOST_AUTO_TEST_CASE(dbwrapper_batch)
 {
@@ -103,4 +103,34 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("2041d16f2e09478c24599a94710a12025f77431af913d9322f9baeac5d810d968f56cc1b07e17b4f803454cbe3d842168ac4b04d676dfd18d601079b662c1df443"));
 }
 
+BOOST_AUTO_TEST_CASE(key_verify_repeated)
+{
+    // Verification caches parsed keys. The compressed and uncompressed forms
+    // of a key share a cache slot, and must not be mistaken for each other or
+    // for the other keys.
+    std::vector<CKey> keys(16);
+    std::vector<CPubKey> pubkeys;
+    std::vector<std::vector<unsigned char>> sigs;
+    uint256 hashMsg = InsecureRand256();
+    for (size_t i = 0; i < keys.size(); i++) {
+        keys[i].MakeNewKey(i % 2 == 0);
+        pubkeys.push_back(keys[i].GetPubKey());
+        sigs.emplace_back();
+        BOOST_CHECK(keys[i].Sign(hashMsg, sigs.back()));
+    }
+    CPubKey pubkeyUncompressed = pubkeys[0];
+    BOOST_CHECK(pubkeyUncompressed.Decompress());
+    BOOST_CHECK(pubkeyUncompressed != pubkeys[0]);
+
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < keys.size(); i++) {
+            for (size_t j = 0; j < keys.size(); j++) {
+                BOOST_CHECK_EQUAL(pubkeys[i].Verify(hashMsg, sigs[j]), i == j);
+            }
+            BOOST_CHECK(pubkeyUncompressed.Verify(hashMsg, sigs[0]));
+            BOOST_CHECK(!pubkeyUncompressed.Verify(hashMsg, sigs[1]));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -24,7 +24,23 @@
 
 #include <boost/test/unit_test.hpp>
 
-BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
+// The blocks TestBlockValidity checks here are large enough for CheckBlock to
+// hand their transactions to the block check threads.
+struct MinerTestingSetup : public TestingSetup {
+    MinerTestingSetup()
+    {
+        nBlockCheckThreads = 3;
+        for (int i=0; i < nBlockCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadBlockCheck);
+    }
+
+    ~MinerTestingSetup()
+    {
+        nBlockCheckThreads = 0;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(miner_tests, MinerTestingSetup)
 
 // BOOST_CHECK_EXCEPTION predicates to check the specific validation error
 class HasReason {
@@ -5,8 +5,10 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <pow.h>
+#include <primitives/block.h>
 #include <random.h>
 #include <util.h>
+#include <validation.h>
 #include <test/test_bitcoin.h>
 
 #include <boost/test/unit_test.hpp>
@@ -83,4 +85,166 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/* Compiled CryptonightR programs must hash like the interpreter, for many heights */
+BOOST_AUTO_TEST_CASE(cn_slow_hash_v4_jit_test)
+{
+    crypto::slow_hash_info info;
+    crypto::slow_hash_get_info(&info);
+    if (!info.cn_v4_jit) {
+        BOOST_TEST_MESSAGE("CryptonightR JIT not available, skipping");
+        return;
+    }
+
+    unsigned char blob[76];
+    for (uint64_t height = 0; height < 40; height++) {
+        const uint64_t test_height = height * 7919 + InsecureRandRange(7919);
+        GetRandBytes(blob, sizeof(blob));
+        char jit[crypto::HASH_SIZE];
+        char interpreted[crypto::HASH_SIZE];
+        crypto::cn_slow_hash_set_v4_jit(1);
+        crypto::cn_slow_hash(blob, sizeof(blob), jit, 4, 0, test_height);
+        crypto::cn_slow_hash_set_v4_jit(0);
+        crypto::cn_slow_hash(blob, sizeof(blob), interpreted, 4, 0, test_height);
+        BOOST_CHECK_MESSAGE(memcmp(jit, interpreted, crypto::HASH_SIZE) == 0, "height " << test_height);
+    }
+    crypto::cn_slow_hash_set_v4_jit(1);
+}
+
+/* Pipelined RandomX hashing must give the same results as one hash per call */
+BOOST_AUTO_TEST_CASE(rx_slow_hash_batch_test)
+{
+    const uint64_t height = 4096;
+    const uint64_t seed_height = crypto::rx_seedheight(height);
+    char seed_hash[32];
+    memset(seed_hash, 0x5a, sizeof(seed_hash));
+
+    std::vector<std::string> blobs;
+    for (int i = 0; i < 5; i++) {
+        blobs.push_back(std::string(76 + i, (char)('a' + i)));
+    }
+    std::vector<const void*> data;
+    std::vector<size_t> lengths;
+    for (const std::string& blob : blobs) {
+        data.push_back(blob.data());
+        lengths.push_back(blob.size());
+    }
+
+    std::vector<char> batch(blobs.size() * crypto::HASH_SIZE);
+    crypto::rx_slow_hash_batch(height, seed_height, seed_hash, data.data(), lengths.data(), blobs.size(), batch.data());
+    for (size_t i = 0; i < blobs.size(); i++) {
+        char single[crypto::HASH_SIZE];
+        crypto::rx_slow_hash(height, seed_height, seed_hash, blobs[i].data(), blobs[i].size(), single, 0, 0);
+        BOOST_CHECK(memcmp(single, &batch[i * crypto::HASH_SIZE], crypto::HASH_SIZE) == 0);
+    }
+}
+
+/* Scanning nonces must give the same hashes as setting each nonce and hashing */
+BOOST_AUTO_TEST_CASE(rx_slow_hash_nonces_test)
+{
+    const uint64_t height = 4096;
+    const uint64_t seed_height = crypto::rx_seedheight(height);
+    char seed_hash[32];
+    memset(seed_hash, 0x5a, sizeof(seed_hash));
+
+    CryptoNoteHeader header;
+    header.major_version = RX_BLOCK_VERSION;
+    header.timestamp = 1541440000;
+    header.nTxes = 1;
+    unsigned char blob[CN_HEADER_MAX_BLOB_SIZE];
+    const size_t size = header.GetBlob(blob);
+    const size_t offset = header.GetNonceOffset();
+    BOOST_CHECK_EQUAL(offset, 1 + 1 + 5 + 32);
+
+    const uint32_t first = 0xfffffffe;
+    const size_t count = 4;
+    std::vector<char> scanned(count * crypto::HASH_SIZE);
+    crypto::rx_slow_hash_nonces(height, seed_height, seed_hash, blob, size, offset, first, count, scanned.data(), 0);
+    for (size_t i = 0; i < count; i++) {
+        header.nonce = first + (uint32_t)i;
+        unsigned char single_blob[CN_HEADER_MAX_BLOB_SIZE];
+        BOOST_CHECK_EQUAL(header.GetBlob(single_blob), size);
+        char single[crypto::HASH_SIZE];
+        crypto::rx_slow_hash(height, seed_height, seed_hash, single_blob, size, single, 0, 0);
+        BOOST_CHECK(memcmp(single, &scanned[i * crypto::HASH_SIZE], crypto::HASH_SIZE) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(seed_height_index_test)
+{
+    CSeedHeightIndex index;
+    CBlockIndex a, b;
+    const uint64_t far = CSeedHeightIndex::EPOCH_BLOCKS * CSeedHeightIndex::CHUNK_SIZE * 3;
+
+    BOOST_CHECK(index.Get(0) == nullptr);
+    BOOST_CHECK(index.Get(far) == nullptr);
+
+    index.Add(0, &a);
+    index.Add(far, &a);
+    BOOST_CHECK(index.Get(0) == &a);
+    BOOST_CHECK(index.Get(far) == &a);
+
+    // Add keeps the first entry, Set replaces it.
+    index.Add(0, &b);
+    BOOST_CHECK(index.Get(0) == &a);
+    index.Set(0, &b);
+    BOOST_CHECK(index.Get(0) == &b);
+
+    // Heights that are not epoch boundaries are never stored.
+    index.Set(CSeedHeightIndex::EPOCH_BLOCKS + 1, &a);
+    BOOST_CHECK(index.Get(CSeedHeightIndex::EPOCH_BLOCKS + 1) == nullptr);
+    BOOST_CHECK(index.Get(CSeedHeightIndex::EPOCH_BLOCKS) == nullptr);
+
+    index.Clear();
+    BOOST_CHECK(index.Get(0) == nullptr);
+    BOOST_CHECK(index.Get(far) == nullptr);
+}
+
+/* The seed height entries DisconnectTip leaves behind over a reorg */
+BOOST_AUTO_TEST_CASE(seed_height_index_reorg_test)
+{
+    // Chain A, and chain B forking off it below the seed height h.
+    const int h = CSeedHeightIndex::EPOCH_BLOCKS;
+    std::vector<CBlockIndex> chainA(h + 2), chainB(4);
+    for (size_t i = 0; i < chainA.size(); i++) {
+        chainA[i].nHeight = i;
+        chainA[i].pprev = i ? &chainA[i - 1] : nullptr;
+    }
+    for (size_t i = 0; i < chainB.size(); i++) {
+        chainB[i].nHeight = h - 1 + i;
+        chainB[i].pprev = i ? &chainB[i - 1] : &chainA[h - 2];
+    }
+    CBlockIndex* pindexA = &chainA[h];
+    CBlockIndex* pindexB = &chainB[1];
+    BlockMap blockIndex;
+    blockIndex[uint256S("0a")] = pindexA;
+    blockIndex[uint256S("0b")] = pindexB;
+
+    // Both headers arrive, then chain A is connected.
+    CSeedHeightIndex index;
+    index.Add(h, pindexA);
+    index.Add(h, pindexB);
+    index.Set(h, pindexA);
+
+    // Reorg to chain B, the best header chain.
+    index.Set(h, FindSeedBlockFallback(blockIndex, &chainB.back(), pindexA));
+    BOOST_CHECK(index.Get(h) == pindexB);
+    index.Set(h, pindexB);
+
+    // Invalidating B falls back to A, even though the best header is still on B.
+    pindexB->nStatus |= BLOCK_FAILED_VALID;
+    index.Set(h, FindSeedBlockFallback(blockIndex, &chainB.back(), pindexB));
+    BOOST_CHECK(index.Get(h) == pindexA);
+    index.Set(h, pindexA);
+
+    // Invalidating A as well leaves nothing to point at.
+    pindexA->nStatus |= BLOCK_FAILED_VALID;
+    index.Set(h, FindSeedBlockFallback(blockIndex, &chainB.back(), pindexA));
+    BOOST_CHECK(index.Get(h) == nullptr);
+
+    // A valid block that is the only one at its height keeps its entry.
+    pindexA->nStatus = 0;
+    blockIndex.erase(uint256S("0b"));
+    BOOST_CHECK(FindSeedBlockFallback(blockIndex, &chainA.back(), pindexA) == pindexA);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1623,4 +1623,166 @@ BOOST_AUTO_TEST_CASE(bitcoinconsensus_verify_script_invalid_flags)
 }
 
 #endif
+
+/** Records the signature checks and accepts any signature with hash type SIGHASH_ALL. */
+class RecordingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    mutable std::vector<std::tuple<valtype, valtype, CScript, SigVersion>> checks;
+
+    bool CheckSig(const std::vector<unsigned char>& vchSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override
+    {
+        checks.emplace_back(vchSig, vchPubKey, scriptCode, sigversion);
+        return !vchSig.empty() && vchSig.back() == SIGHASH_ALL;
+    }
+};
+
+static CScript PushRedeemScript(const uint160& hash)
+{
+    const CScript redeemScript = CScript() << OP_0 << ToByteVector(hash);
+    return CScript() << ToByteVector(redeemScript);
+}
+
+/* Compare the fast paths of VerifyScript for standard and keva scripts with
+ * the interpreter: for every combination of keva prefix, output type and
+ * spend both must agree on the result, the error and the signature checks
+ * they make. */
+BOOST_AUTO_TEST_CASE(script_standard_fast_path)
+{
+    const KeyData keys;
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(keys.key0.Sign(uint256S("0x4b3f"), vchSig));
+    valtype sigHighS = vchSig;
+    NegateSignatureS(sigHighS);
+    sigHighS.push_back(SIGHASH_ALL);
+    valtype sigBadDER = vchSig;
+    sigBadDER[0] = 0x31;
+    sigBadDER.push_back(SIGHASH_ALL);
+    valtype sigNone = vchSig;
+    sigNone.push_back(SIGHASH_NONE);
+    valtype sigAll = vchSig;
+    sigAll.push_back(SIGHASH_ALL);
+    const std::vector<valtype> sigs = {sigAll, sigNone, sigHighS, sigBadDER, valtype(), valtype(2, SIGHASH_ALL), valtype(2, SIGHASH_NONE)};
+
+    const valtype pubkeyC = ToByteVector(keys.pubkey0C);
+    const valtype pubkeyU = ToByteVector(keys.pubkey0);
+    const std::vector<valtype> pubkeys = {pubkeyC, pubkeyU, ToByteVector(keys.pubkey0H), ToByteVector(keys.pubkey1C)};
+    const uint160 hashC = keys.pubkey0C.GetID();
+    const uint160 hashU = keys.pubkey0.GetID();
+    const uint160 hashZero;
+
+    const valtype nameSpace(21, 'n');
+    const valtype key(3, 'k');
+    const valtype value(100, 'v');
+    const std::vector<CScript> prefixes = {
+        CScript(),
+        CScript() << OP_KEVA_NAMESPACE << nameSpace << value << OP_2DROP,
+        CScript() << OP_KEVA_PUT << nameSpace << key << value << OP_2DROP << OP_DROP,
+        CScript() << OP_KEVA_DELETE << nameSpace << key << OP_2DROP,
+        // Not a minimal push
+        CScript() << OP_KEVA_PUT << nameSpace << valtype(1, 5) << value << OP_2DROP << OP_DROP,
+        // Argument too large for the interpreter
+        CScript() << OP_KEVA_PUT << nameSpace << key << valtype(MAX_SCRIPT_ELEMENT_SIZE + 1, 'v') << OP_2DROP << OP_DROP,
+        // Leaves an argument on the stack
+        CScript() << OP_KEVA_PUT << nameSpace << key << value << OP_2DROP,
+        // Contains a signature push that OP_CHECKSIG removes from the script code
+        CScript() << OP_KEVA_PUT << nameSpace << key << sigNone << OP_2DROP << OP_DROP,
+    };
+
+    std::vector<CScript> addresses;
+    for (const uint160& hash : {hashC, hashU, hashZero}) {
+        const CScript redeemScript = CScript() << OP_0 << ToByteVector(hash);
+        addresses.push_back(CScript() << OP_DUP << OP_HASH160 << ToByteVector(hash) << OP_EQUALVERIFY << OP_CHECKSIG);
+        addresses.push_back(redeemScript);
+        addresses.push_back(GetScriptForDestination(CScriptID(redeemScript)));
+    }
+
+    std::vector<CScript> scriptSigs = {CScript(), PushRedeemScript(hashC), PushRedeemScript(hashZero)};
+    for (const valtype& sig : sigs) {
+        for (const valtype& pubkey : pubkeys) {
+            scriptSigs.push_back(CScript() << sig << pubkey);
+        }
+    }
+    const CScript redeemScriptC = CScript() << OP_0 << ToByteVector(hashC);
+    scriptSigs.push_back(CScript() << OP_PUSHDATA1 << (unsigned char)redeemScriptC.size() << ToByteVector(redeemScriptC));
+    scriptSigs.push_back(CScript() << OP_PUSHDATA1 << (unsigned char)sigAll.size() << sigAll << pubkeyC);
+    scriptSigs.push_back(CScript() << sigAll << pubkeyC << OP_NOP);
+    scriptSigs.push_back(CScript() << sigAll << pubkeyC << pubkeyC);
+    scriptSigs.push_back(CScript() << pubkeyC);
+
+    std::vector<CScriptWitness> witnesses(1);
+    for (const valtype& sig : sigs) {
+        for (const valtype& pubkey : pubkeys) {
+            witnesses.emplace_back();
+            witnesses.back().stack = {sig, pubkey};
+        }
+    }
+    witnesses.emplace_back();
+    witnesses.back().stack = {sigAll, pubkeyC, pubkeyC};
+    witnesses.emplace_back();
+    witnesses.back().stack = {valtype(MAX_SCRIPT_ELEMENT_SIZE + 1, SIGHASH_ALL), pubkeyC};
+
+    // Pair every scriptSig with no witness and a valid one, and every witness
+    // with the scriptSigs of native and P2SH-wrapped P2WPKH.
+    std::vector<std::pair<CScript, CScriptWitness>> spends;
+    for (const CScript& scriptSig : scriptSigs) {
+        spends.emplace_back(scriptSig, witnesses[0]);
+        spends.emplace_back(scriptSig, witnesses[1]);
+    }
+    for (const CScriptWitness& witness : witnesses) {
+        spends.emplace_back(CScript(), witness);
+        spends.emplace_back(PushRedeemScript(hashC), witness);
+    }
+
+    // Every case runs with each base flag set, combined with none, all and a
+    // random selection of the flags that change how signatures are checked.
+    const unsigned int baseFlags[] = {0, SCRIPT_VERIFY_P2SH, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK};
+    const unsigned int optionalFlags[] = {SCRIPT_VERIFY_STRICTENC, SCRIPT_VERIFY_DERSIG, SCRIPT_VERIFY_LOW_S, SCRIPT_VERIFY_NULLFAIL, SCRIPT_VERIFY_MINIMALDATA, SCRIPT_VERIFY_WITNESS_PUBKEYTYPE, SCRIPT_VERIFY_CONST_SCRIPTCODE};
+    const unsigned int nOptional = ARRAYLEN(optionalFlags);
+
+    SeedInsecureRand(false);
+    size_t nSuccess = 0;
+    for (const CScript& prefix : prefixes) {
+        for (const CScript& address : addresses) {
+            const CScript scriptPubKey = prefix + address;
+            for (const auto& spend : spends) {
+                for (unsigned int base : baseFlags) {
+                    for (int i = 0; i < 10; i++) {
+                        const uint64_t mask = i == 0 ? 0 : i == 1 ? (1U << nOptional) - 1 : InsecureRandBits(nOptional);
+                        unsigned int flags = base;
+                        for (unsigned int j = 0; j < nOptional; j++) {
+                            if (mask & (1U << j))
+                                flags |= optionalFlags[j];
+                        }
+                        RecordingSignatureChecker checker, checkerInterpreted;
+                        ScriptError err, errInterpreted;
+                        const bool ret = VerifyScript(spend.first, scriptPubKey, &spend.second, flags, checker, &err);
+                        const bool retInterpreted = VerifyScriptInterpreted(spend.first, scriptPubKey, &spend.second, flags, checkerInterpreted, &errInterpreted);
+                        if (ret != retInterpreted || err != errInterpreted || checker.checks != checkerInterpreted.checks) {
+                            BOOST_ERROR("fast path differs for " + FormatScript(spend.first) + " / " + FormatScript(scriptPubKey) + strprintf(" (with flags %x): ", flags) + FormatScriptError(err) + " vs " + FormatScriptError(errInterpreted));
+                        }
+                        nSuccess += ret;
+                    }
+                }
+            }
+        }
+    }
+    // Make sure the comparison covered the fast paths succeeding
+    BOOST_CHECK(nSuccess > 0);
+
+    // And with real signatures
+    CMutableTransaction txCredit = BuildCreditingTransaction(prefixes[2] + addresses[0], 1);
+    CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), CScriptWitness(), txCredit);
+    std::vector<unsigned char> vchSigSpend;
+    BOOST_CHECK(keys.key0C.Sign(SignatureHash(txCredit.vout[0].scriptPubKey, txSpend, 0, SIGHASH_ALL, 1, SIGVERSION_BASE), vchSigSpend));
+    vchSigSpend.push_back(SIGHASH_ALL);
+    txSpend.vin[0].scriptSig = CScript() << vchSigSpend << pubkeyC;
+    ScriptError err;
+    BOOST_CHECK(VerifyScript(txSpend.vin[0].scriptSig, txCredit.vout[0].scriptPubKey, nullptr, gFlags, MutableTransactionSignatureChecker(&txSpend, 0, 1), &err));
+    BOOST_CHECK_EQUAL(err, SCRIPT_ERR_OK);
+    txSpend.vin[0].nSequence = 0;
+    BOOST_CHECK(!VerifyScript(txSpend.vin[0].scriptSig, txCredit.vout[0].scriptPubKey, nullptr, gFlags, MutableTransactionSignatureChecker(&txSpend, 0, 1), &err));
+    BOOST_CHECK_EQUAL(err, SCRIPT_ERR_EVAL_FALSE);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
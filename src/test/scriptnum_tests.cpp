@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <test/scriptnum10.h>
+#include <script/interpreter.h>
 #include <script/script.h>
 #include <test/test_bitcoin.h>
 
@@ -36,6 +37,12 @@ static void CheckCreateVch(const int64_t& num)
     CScriptNum10 bignum3(scriptnum2.getvch(), false);
     CScriptNum scriptnum3(bignum2.getvch(), false);
     BOOST_CHECK(verify(bignum3, scriptnum3));
+
+    // The interpreter serializes to and parses from its stack elements.
+    StackElement element;
+    scriptnum.getvch(element);
+    BOOST_CHECK(std::vector<unsigned char>(element.begin(), element.end()) == scriptnum.getvch());
+    BOOST_CHECK(verify(bignum, CScriptNum(element, false)));
 }
 
 static void CheckCreateInt(const int64_t& num)
@@ -5,6 +5,8 @@
 #include <serialize.h>
 #include <streams.h>
 #include <hash.h>
+#include <chain.h>
+#include <primitives/block.h>
 #include <test/test_bitcoin.h>
 
 #include <stdint.h>
@@ -365,4 +367,93 @@ BOOST_AUTO_TEST_CASE(class_methods)
     BOOST_CHECK(methodtest3 == methodtest4);
 }
 
+BOOST_AUTO_TEST_CASE(cnheader_blob)
+{
+    for (int i = 0; i < 1000; i++) {
+        CryptoNoteHeader header;
+        header.major_version = InsecureRandBits(8);
+        header.minor_version = InsecureRandBits(8);
+        header.timestamp = InsecureRandBits(InsecureRandRange(65));
+        header.prev_id = InsecureRand256();
+        header.nonce = InsecureRand32();
+        header.merkle_root = InsecureRand256();
+        header.nTxes = InsecureRandBits(InsecureRandRange(65));
+
+        // The stack encoder must match the cryptonote archive byte for byte.
+        unsigned char blob[CN_HEADER_MAX_BLOB_SIZE];
+        size_t nSize = header.GetBlob(blob);
+        cryptonote::blobdata expected = cryptonote::t_serializable_object_to_blob(header);
+        BOOST_CHECK_EQUAL(HexStr(blob, blob + nSize), HexStr(expected));
+
+        CDataStream ss(SER_DISK, 0);
+        ss << header;
+        CryptoNoteHeader header2;
+        ss >> header2;
+        BOOST_CHECK_EQUAL(header2.timestamp, header.timestamp);
+        BOOST_CHECK(header2.prev_id == header.prev_id);
+        BOOST_CHECK_EQUAL(header2.nonce, header.nonce);
+        BOOST_CHECK_EQUAL(header2.nTxes, header.nTxes);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cnheader_hash_memo)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.nTime = 1500000000;
+    header.nBits = 0x207fffff;
+    header.cnHeader.major_version = 10;
+    header.cnHeader.prev_id = header.GetOriginalBlockHash();
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(hash == header.GetHash());
+
+    // Mutating any field must not return the memoized hash.
+    header.cnHeader.nonce++;
+    uint256 hash2 = header.GetHash();
+    BOOST_CHECK(hash2 != hash);
+    header.nTime++;
+    BOOST_CHECK(header.GetHash() != hash2);
+    header.cnHeader.prev_id = header.GetOriginalBlockHash();
+    BOOST_CHECK(header.GetHash() != hash2);
+
+    CBlockHeader copy = header;
+    BOOST_CHECK(copy.GetHash() == header.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(blockindex_cnheader)
+{
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = 1560000000;
+    header.nBits = 0x1b015318;
+    header.nNonce = 878439;
+    header.cnHeader.major_version = 12;
+    header.cnHeader.minor_version = 3;
+    header.cnHeader.timestamp = 1560000001;
+    header.cnHeader.prev_id = header.GetOriginalBlockHash();
+    header.cnHeader.nonce = InsecureRand32();
+    header.cnHeader.merkle_root = InsecureRand256();
+    header.cnHeader.nTxes = 1;
+    const uint256 hash = header.GetHash();
+
+    // The index drops prev_id; it must come back from the other fields.
+    CBlockIndex prev;
+    prev.phashBlock = &header.hashPrevBlock;
+    CBlockIndex index(header);
+    index.pprev = &prev;
+    index.phashBlock = &hash;
+    BOOST_CHECK(index.GetBlockHeader().cnHeader.prev_id == header.cnHeader.prev_id);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+    CDiskBlockIndex diskindex;
+    ss >> diskindex;
+    BOOST_CHECK(diskindex.GetBlockHash() == hash);
+    BOOST_CHECK(diskindex.hashCNPrevId == header.cnHeader.prev_id);
+    BOOST_CHECK_EQUAL(diskindex.nCNNonce, header.cnHeader.nonce);
+    BOOST_CHECK(diskindex.hashCNMerkleRoot == header.cnHeader.merkle_root);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -208,4 +208,31 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
+
+// Goal: check that the legacy midstates of PrecomputedTransactionData give the same hashes
+BOOST_AUTO_TEST_CASE(sighash_legacy_midstate)
+{
+    SeedInsecureRand(false);
+
+    for (int i = 0; i < 20; i++) {
+        CMutableTransaction txTo;
+        RandomTransaction(txTo, false);
+        while (txTo.vin.size() < MIN_LEGACY_MIDSTATE_INPUTS + i) {
+            txTo.vin.push_back(txTo.vin[0]);
+            txTo.vin.back().prevout.hash = InsecureRand256();
+        }
+        const CTransaction tx(txTo);
+        const PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK_EQUAL(txdata.legacyMidstates.size(), tx.vin.size());
+
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            CScript scriptCode;
+            RandomScript(scriptCode);
+            const int nHashType = InsecureRandBool() ? (int)SIGHASH_ALL : (int)InsecureRand32();
+            const uint256 sh = SignatureHash(scriptCode, tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata);
+            BOOST_CHECK(sh == SignatureHashOld(scriptCode, tx, nIn, nHashType));
+            BOOST_CHECK(sh == SignatureHash(scriptCode, tx, nIn, nHashType, 0, SIGVERSION_BASE));
+        }
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include <txdb.h>
 
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <hash.h>
 #include <random.h>
 #include <pow.h>
@@ -58,6 +59,60 @@ struct CoinEntry {
 
 }
 
+namespace {
+
+/** Reads the coins of a run of outpoints from a database snapshot. */
+class CCoinsReadCheck
+{
+private:
+    const CDBWrapper* pdb;
+    const leveldb::Snapshot* snapshot;
+    const COutPoint* pOutpoints;
+    Coin* pCoins;
+    size_t nCount;
+
+public:
+    CCoinsReadCheck() : pdb(nullptr), snapshot(nullptr), pOutpoints(nullptr), pCoins(nullptr), nCount(0) {}
+    CCoinsReadCheck(const CDBWrapper& db, const leveldb::Snapshot* snapshotIn, const COutPoint* pOutpointsIn, Coin* pCoinsIn, size_t nCountIn) :
+        pdb(&db), snapshot(snapshotIn), pOutpoints(pOutpointsIn), pCoins(pCoinsIn), nCount(nCountIn) {}
+
+    bool operator()()
+    {
+        try {
+            for (size_t i = 0; i < nCount; i++) {
+                if (!pdb->Read(CoinEntry(&pOutpoints[i]), pCoins[i], snapshot))
+                    pCoins[i].Clear();
+            }
+        } catch (const std::exception& e) {
+            // Leave the rest unread; the caller will read them again itself.
+            LogPrintf("%s: %s\n", __func__, e.what());
+            return false;
+        }
+        return true;
+    }
+
+    void swap(CCoinsReadCheck& check)
+    {
+        std::swap(pdb, check.pdb);
+        std::swap(snapshot, check.snapshot);
+        std::swap(pOutpoints, check.pOutpoints);
+        std::swap(pCoins, check.pCoins);
+        std::swap(nCount, check.nCount);
+    }
+};
+
+} // namespace
+
+static CCheckQueue<CCoinsReadCheck> coinsreadqueue(1);
+
+//! Outpoints read per check; a check only pays off with enough reads to share.
+static const size_t COINS_READS_PER_CHECK = 16;
+
+void ThreadCoinsRead() {
+    RenameThread("kevacoin-coinsrd");
+    coinsreadqueue.Thread();
+}
+
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
 {
 }
@@ -77,6 +132,25 @@ uint256 CCoinsViewDB::GetBestBlock() const {
     return hashBestChain;
 }
 
+uint256 CCoinsViewDB::GetCoins(const std::vector<COutPoint>& vOutpoints, std::vector<Coin>& vCoins) const {
+    std::shared_ptr<const leveldb::Snapshot> snapshot = db.GetSnapshot();
+    uint256 hashBestChain;
+    if (!db.Read(DB_BEST_BLOCK, hashBestChain, snapshot.get()))
+        hashBestChain.SetNull();
+
+    vCoins.assign(vOutpoints.size(), Coin());
+    std::vector<CCoinsReadCheck> vChecks;
+    vChecks.reserve((vOutpoints.size() + COINS_READS_PER_CHECK - 1) / COINS_READS_PER_CHECK);
+    for (size_t i = 0; i < vOutpoints.size(); i += COINS_READS_PER_CHECK) {
+        vChecks.emplace_back(db, snapshot.get(), &vOutpoints[i], &vCoins[i], std::min(COINS_READS_PER_CHECK, vOutpoints.size() - i));
+    }
+    // Without ThreadCoinsRead workers the calling thread does all reads in Wait().
+    CCheckQueueControl<CCoinsReadCheck> control(&coinsreadqueue);
+    control.Add(vChecks);
+    control.Wait();
+    return hashBestChain;
+}
+
 std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     std::vector<uint256> vhashHeadBlocks;
     if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks)) {
@@ -386,8 +460,16 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
         if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
             CDiskBlockIndex diskindex;
             if (pcursor->GetValue(diskindex)) {
+                // The index rebuilds prev_id and the block hash from the
+                // header fields, so they must agree with what was stored.
+                // Otherwise the entry would be indexed under a hash it does
+                // not have.
+                const CBlockHeader header = diskindex.GetBlockHeader();
+                if (header.cnHeader.prev_id != diskindex.hashCNPrevId || header.GetHash() != key.second)
+                    return error("%s: block index entry does not match its hash: %s", __func__, key.second.ToString());
+
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash(), diskindex.nHeight);
+                CBlockIndex* pindexNew = insertBlockIndex(key.second, diskindex.nHeight);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev, diskindex.nHeight - 1);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -400,7 +482,12 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
-                pindexNew->cnHeader       = diskindex.cnHeader;
+                pindexNew->nCNMajorVersion  = diskindex.nCNMajorVersion;
+                pindexNew->nCNMinorVersion  = diskindex.nCNMinorVersion;
+                pindexNew->nCNTimestamp     = diskindex.nCNTimestamp;
+                pindexNew->nCNNonce         = diskindex.nCNNonce;
+                pindexNew->hashCNMerkleRoot = diskindex.hashCNMerkleRoot;
+                pindexNew->nCNTxes          = diskindex.nCNTxes;
 
                 // Kevacoin: Disable PoW Sanity check while loading block index from disk.
                 // We use the sha256 hash for the block index for performance reasons, which is recorded for later use.
@@ -84,6 +84,15 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CKevaCache &names) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Read the coins of many outpoints from one snapshot of the database,
+     * shared with the ThreadCoinsRead workers. Only one thread may call this
+     * at a time. Outpoints that are not found, or could not be read, get a
+     * spent coin. Returns the best block of the snapshot,
+     * which is null if it was taken during a flush.
+     */
+    uint256 GetCoins(const std::vector<COutPoint>& vOutpoints, std::vector<Coin>& vCoins) const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -132,4 +141,7 @@ public:
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&, int)> insertBlockIndex);
 };
 
+/** Run an instance of the thread reading coins for CCoinsViewDB::GetCoins */
+void ThreadCoinsRead();
+
 #endif // BITCOIN_TXDB_H
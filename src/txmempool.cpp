@@ -11,7 +11,9 @@
 #include <validation.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <memusage.h>
 #include <reverse_iterator.h>
+#include <script/interpreter.h>
 #include <streams.h>
 #include <timedata.h>
 #include <util.h>
@@ -53,6 +55,17 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     }
 }
 
+void CTxMemPoolEntry::SetPrecomputedData(const std::shared_ptr<const PrecomputedTransactionData>& txdataIn)
+{
+    if (txdata) {
+        nUsageSize -= memusage::DynamicUsage(txdata) + memusage::DynamicUsage(txdata->legacyMidstates);
+    }
+    txdata = txdataIn;
+    if (txdata) {
+        nUsageSize += memusage::DynamicUsage(txdata) + memusage::DynamicUsage(txdata->legacyMidstates);
+    }
+}
+
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
 {
     nModFeesWithDescendants += newFeeDelta - feeDelta;
@@ -843,6 +856,15 @@ CTransactionRef CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+std::shared_ptr<const PrecomputedTransactionData> CTxMemPool::GetPrecomputedData(const uint256& hash) const
+{
+    LOCK(cs);
+    indexed_transaction_set::const_iterator i = mapTx.find(hash);
+    if (i == mapTx.end())
+        return nullptr;
+    return i->GetPrecomputedData();
+}
+
 TxMempoolInfo CTxMemPool::info(const uint256& hash) const
 {
     LOCK(cs);
@@ -30,6 +30,7 @@
 #include <boost/signals2/signal.hpp>
 
 class CBlockIndex;
+struct PrecomputedTransactionData;
 
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
@@ -93,6 +94,9 @@ private:
     /* Cache keva operation (if any) performed by this tx.  */
     CKevaScript kevaOp;
 
+    //! Signature hash data computed when the tx was accepted, reused when it is mined
+    std::shared_ptr<const PrecomputedTransactionData> txdata;
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
@@ -110,6 +114,9 @@ public:
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
+    const std::shared_ptr<const PrecomputedTransactionData>& GetPrecomputedData() const { return txdata; }
+    // Keep the signature hash data of the tx, adding it to the memory usage
+    void SetPrecomputedData(const std::shared_ptr<const PrecomputedTransactionData>& txdataIn);
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -714,6 +721,8 @@ public:
     void getUnconfirmedKeyValueList(std::vector<std::tuple<valtype, valtype, valtype, uint256>>& keyValueList, const valtype& nameSpace);
 
     CTransactionRef get(const uint256& hash) const;
+    /** The signature hash data cached with a mempool tx, or nullptr. */
+    std::shared_ptr<const PrecomputedTransactionData> GetPrecomputedData(const uint256& hash) const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
@@ -154,14 +154,14 @@ public:
     CChain chainActive;
     BlockMap mapBlockIndex;
     std::multimap<CBlockIndex*, CBlockIndex*> mapBlocksUnlinked;
-    BlockSeedHeightMap mapBlockSeedHeight;
+    CSeedHeightIndex seedHeightIndex;
     CBlockIndex *pindexBestInvalid = nullptr;
 
     bool LoadBlockIndex(const Consensus::Params& consensus_params, CBlockTreeDB& blocktree);
 
     bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams, std::shared_ptr<const CBlock> pblock);
 
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex);
+    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pPoWHash = nullptr, bool fMayDeferPoW = false);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock);
 
     // Block (dis)connection on a given view:
@@ -195,6 +195,7 @@ private:
     void CheckBlockIndex(const Consensus::Params& consensusParams);
 
     void InvalidBlockFound(CBlockIndex *pindex, const CValidationState &state);
+    void ResolveAssumedPoW(CBlockIndex* pindexAssumed);
     CBlockIndex* FindMostWorkChain();
     bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 
@@ -207,13 +208,15 @@ private:
 CCriticalSection cs_main;
 
 BlockMap& mapBlockIndex = g_chainstate.mapBlockIndex;
-BlockSeedHeightMap& mapBlockSeedHeight = g_chainstate.mapBlockSeedHeight;
+CSeedHeightIndex& seedHeightIndex = g_chainstate.seedHeightIndex;
 CChain& chainActive = g_chainstate.chainActive;
 CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 uint256 hashBestBlock;
 int nScriptCheckThreads = 0;
+int nBlockCheckThreads = 0;
+bool fBlockPrefetch = false;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = false;
@@ -229,6 +232,8 @@ int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
 uint256 hashAssumeValid;
+uint256 hashAssumeValidPoW;
+int nAssumeValidPoWHeight = -1;
 arith_uint256 nMinimumChainWork;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
@@ -263,6 +268,9 @@ namespace {
     /** Dirty block index entries. */
     std::set<CBlockIndex*> setDirtyBlockIndex;
 
+    /** Block index entries with BLOCK_POW_ASSUMED, whose PoW check is still deferred. */
+    std::set<CBlockIndex*> setPoWAssumedBlockIndex;
+
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
 } // anon namespace
@@ -300,7 +308,7 @@ enum FlushStateMode {
 static bool FlushStateToDisk(const CChainParams& chainParams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight=0);
 static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight);
 static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfterHeight);
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, const PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = nullptr);
 static FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 
 bool CheckFinalTx(const CTransaction &tx, int flags)
@@ -516,7 +524,7 @@ void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool f
 // Used to avoid mempool polluting consensus critical paths if CCoinsViewMempool
 // were somehow broken and returning the wrong scriptPubKeys
 static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &view, CTxMemPool& pool,
-                 unsigned int flags, bool cacheSigStore, PrecomputedTransactionData& txdata) {
+                 unsigned int flags, bool cacheSigStore, const PrecomputedTransactionData& txdata) {
     AssertLockHeld(cs_main);
 
     // pool.cs should be locked already, but go ahead and re-take the lock here
@@ -939,7 +947,10 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        PrecomputedTransactionData txdata(tx);
+        // The precomputed data is kept with the mempool entry so ConnectBlock
+        // does not hash the transaction again.
+        std::shared_ptr<PrecomputedTransactionData> ptxdata = std::make_shared<PrecomputedTransactionData>(tx);
+        const PrecomputedTransactionData& txdata = *ptxdata;
         if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false, txdata)) {
             // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
             // need to turn both off, and compare against just turning off CLEANSTACK
@@ -1013,6 +1024,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         bool validForFeeEstimation = !fReplacementTransaction && !bypass_limits && IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
 
         // Store transaction in memory
+        entry.SetPrecomputedData(ptxdata);
         pool.addUnchecked(hash, entry, setAncestors, validForFeeEstimation);
 
         // trim mempool and check if tx was trimmed
@@ -1344,6 +1356,109 @@ void CChainState::InvalidBlockFound(CBlockIndex *pindex, const CValidationState
     }
 }
 
+/**
+ * Whether the PoW of pindex may be taken for granted: it is an ancestor of
+ * the -assumevalidpow block, which is on our best header chain, and that
+ * chain has at least the minimum chain work. The headers still link up by
+ * hash and their chain work still follows from nBits.
+ */
+static bool IsPoWAssumedValid(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (pindex == nullptr || hashAssumeValidPoW.IsNull())
+        return false;
+    BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValidPoW);
+    if (it == mapBlockIndex.end())
+        return false;
+    const CBlockIndex* pindexAssumed = it->second;
+    return pindexAssumed->GetAncestor(pindex->nHeight) == pindex &&
+           pindexBestHeader != nullptr &&
+           pindexBestHeader->GetAncestor(pindexAssumed->nHeight) == pindexAssumed &&
+           pindexBestHeader->nChainWork >= nMinimumChainWork;
+}
+
+/**
+ * Whether the PoW check of a new header building on pindexPrev is deferred:
+ * up to an -assumevalidpow checkpoint we have not seen yet, it waits until
+ * the checkpoint header arrives and proves its ancestors (see
+ * ResolveAssumedPoW), or until the block data is stored. Only headers
+ * descending from the last checkpoint we know are deferred, so that a peer
+ * cannot fork off wherever it likes for free, and no more of them, from all
+ * peers together and across restarts, than the chain between that checkpoint
+ * and the -assumevalidpow one holds. Once that budget is spent, headers are
+ * checked as usual.
+ */
+static bool IsPoWDeferred(const CBlockIndex* pindexPrev, const CChainParams& chainparams)
+{
+    AssertLockHeld(cs_main);
+    if (nAssumeValidPoWHeight < 0 || pindexPrev->nHeight >= nAssumeValidPoWHeight ||
+        mapBlockIndex.count(hashAssumeValidPoW))
+        return false;
+    const CBlockIndex* pcheckpoint = Checkpoints::GetLastCheckpoint(chainparams.Checkpoints());
+    if (pcheckpoint == nullptr || (pcheckpoint->nStatus & BLOCK_FAILED_MASK) ||
+        pindexPrev->GetAncestor(pcheckpoint->nHeight) != pcheckpoint)
+        return false;
+    return setPoWAssumedBlockIndex.size() < (size_t)(nAssumeValidPoWHeight - pcheckpoint->nHeight);
+}
+
+/** Clear BLOCK_POW_ASSUMED once the PoW of pindex is settled. */
+static void ClearPoWAssumed(CBlockIndex* pindex)
+{
+    if (!(pindex->nStatus & BLOCK_POW_ASSUMED))
+        return;
+    pindex->nStatus &= ~BLOCK_POW_ASSUMED;
+    setPoWAssumedBlockIndex.erase(pindex);
+    setDirtyBlockIndex.insert(pindex);
+}
+
+/**
+ * Settle the headers accepted with BLOCK_POW_ASSUMED now that the
+ * -assumevalidpow checkpoint header is known. Its ancestors are proven by the
+ * hashes linking them to it. Any other such header forks off before the
+ * checkpoint and would have been rejected had the checkpoint been known, so
+ * it is marked invalid along with its descendants.
+ */
+void CChainState::ResolveAssumedPoW(CBlockIndex* pindexAssumed)
+{
+    AssertLockHeld(cs_main);
+    int nFailed = 0;
+    for (CBlockIndex* pindex : setPoWAssumedBlockIndex) {
+        pindex->nStatus &= ~BLOCK_POW_ASSUMED;
+        if (pindexAssumed->GetAncestor(pindex->nHeight) != pindex) {
+            pindex->nStatus |= BLOCK_FAILED_VALID;
+            g_failed_blocks.insert(pindex);
+            nFailed++;
+        }
+        setDirtyBlockIndex.insert(pindex);
+    }
+    setPoWAssumedBlockIndex.clear();
+    if (nFailed == 0)
+        return;
+
+    // Only reached when a peer fed us a fork: mark what was built on it.
+
+    std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
+    vSortedByHeight.reserve(mapBlockIndex.size());
+    for (const std::pair<const uint256, CBlockIndex*>& item : mapBlockIndex)
+        vSortedByHeight.push_back(std::make_pair(item.second->nHeight, item.second));
+    std::sort(vSortedByHeight.begin(), vSortedByHeight.end());
+    for (const std::pair<int, CBlockIndex*>& item : vSortedByHeight) {
+        CBlockIndex* pindex = item.second;
+        if (!(pindex->nStatus & BLOCK_FAILED_MASK) && pindex->pprev && (pindex->pprev->nStatus & BLOCK_FAILED_MASK)) {
+            pindex->nStatus |= BLOCK_FAILED_CHILD;
+            setDirtyBlockIndex.insert(pindex);
+        }
+        if (!(pindex->nStatus & BLOCK_FAILED_MASK))
+            continue;
+        setBlockIndexCandidates.erase(pindex);
+        if (!pindexBestInvalid || pindex->nChainWork > pindexBestInvalid->nChainWork)
+            pindexBestInvalid = pindex;
+    }
+    if (pindexBestHeader && (pindexBestHeader->nStatus & BLOCK_FAILED_MASK))
+        pindexBestHeader = pindexAssumed;
+    LogPrintf("%s: %d headers accepted without a PoW check fork off before checkpoint %s, marked invalid\n", __func__, nFailed, pindexAssumed->GetBlockHash().ToString());
+}
+
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txundo, int nHeight)
 {
     // mark inputs spent
@@ -1405,7 +1520,7 @@ void InitScriptExecutionCache() {
  *
  * Non-static (and re-declared) in src/test/txvalidationcache_tests.cpp
  */
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, const PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks)
 {
     if (!tx.IsCoinBase())
     {
@@ -1738,6 +1853,222 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+namespace {
+
+/**
+ * The context independent checks CheckBlock does on one of the block's
+ * transactions: CheckTransaction and the legacy sigop count. Only success is
+ * reported; CheckBlock redoes the checks in order when one fails, so that it
+ * reports the same error as without threads.
+ */
+class CBlockTxCheck
+{
+private:
+    const CTransaction* ptx;
+    unsigned int* pnSigOps;
+
+public:
+    CBlockTxCheck() : ptx(nullptr), pnSigOps(nullptr) {}
+    CBlockTxCheck(const CTransaction& tx, unsigned int* pnSigOpsIn) : ptx(&tx), pnSigOps(pnSigOpsIn) {}
+
+    bool operator()()
+    {
+        CValidationState state;
+        if (!CheckTransaction(*ptx, state, true))
+            return false;
+        *pnSigOps = GetLegacySigOpCount(*ptx);
+        return true;
+    }
+
+    void swap(CBlockTxCheck& check)
+    {
+        std::swap(ptx, check.ptx);
+        std::swap(pnSigOps, check.pnSigOps);
+    }
+};
+
+} // namespace
+
+static CCheckQueue<CBlockTxCheck> blockcheckqueue(128);
+
+//! Blocks with fewer transactions are checked on the calling thread only.
+static const size_t MIN_PARALLEL_CHECK_TXS = 16;
+
+void ThreadBlockCheck() {
+    RenameThread("kevacoin-blkchk");
+    blockcheckqueue.Thread();
+}
+
+namespace {
+
+/**
+ * Reads the next block to connect from disk and its inputs from the coins
+ * database while the current block is being connected. The inputs are read
+ * on several threads from a database snapshot, and added to pcoinsTip when
+ * ConnectTip takes the block, provided no flush happened in between, so
+ * that ConnectBlock does not have to wait for each read in turn.
+ */
+class CBlockPrefetcher
+{
+private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+
+    //! The block to prefetch next, and where it is stored
+    const CBlockIndex* pindexQueued = nullptr;
+    CDiskBlockPos posQueued;
+
+    //! The block being prefetched
+    const CBlockIndex* pindexBusy = nullptr;
+
+    //! The last block prefetched, until ConnectTip takes it
+    const CBlockIndex* pindexDone = nullptr;
+    std::shared_ptr<const CBlock> pblockDone;
+
+    //! Its inputs, and the best block of the coins database they were read at
+    std::vector<COutPoint> vOutpointsDone;
+    std::vector<Coin> vCoinsDone;
+    uint256 hashCoinsDone;
+
+    std::shared_ptr<const CBlock> Prefetch(const CBlockIndex* pindex, const CDiskBlockPos& pos, std::vector<COutPoint>& vOutpoints, std::vector<Coin>& vCoins, uint256& hashCoins)
+    {
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return nullptr;
+        }
+        try {
+            filein >> *pblock;
+        } catch (const std::exception&) {
+            return nullptr;
+        }
+        // The proof of work is checked again when the block is connected.
+        if (pblock->GetHash() != pindex->GetBlockHash()) {
+            return nullptr;
+        }
+        // Outputs created in the block itself are not in the database yet.
+        std::set<uint256> setTxids;
+        for (const auto& tx : pblock->vtx) {
+            setTxids.insert(tx->GetHash());
+        }
+        for (const auto& tx : pblock->vtx) {
+            if (tx->IsCoinBase()) {
+                continue;
+            }
+            for (const CTxIn& txin : tx->vin) {
+                if (!setTxids.count(txin.prevout.hash)) {
+                    vOutpoints.push_back(txin.prevout);
+                }
+            }
+        }
+        hashCoins = pcoinsdbview->GetCoins(vOutpoints, vCoins);
+        return pblock;
+    }
+
+public:
+    //! Start prefetching the given block, if its data is on disk.
+    void Request(const CBlockIndex* pindex)
+    {
+        AssertLockHeld(cs_main);
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            return;
+        }
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (pindex == pindexBusy || pindex == pindexDone) {
+            return;
+        }
+        pindexQueued = pindex;
+        posQueued = pindex->GetBlockPos();
+        cond.notify_all();
+    }
+
+    /**
+     * Take the prefetched block, waiting for it if it is being prefetched,
+     * and add its inputs to pcoinsTip. Returns nullptr if it was not
+     * prefetched.
+     */
+    std::shared_ptr<const CBlock> Get(const CBlockIndex* pindex)
+    {
+        AssertLockHeld(cs_main);
+        std::shared_ptr<const CBlock> pblock;
+        std::vector<COutPoint> vOutpoints;
+        std::vector<Coin> vCoins;
+        uint256 hashCoins;
+        {
+            boost::this_thread::disable_interruption noInterrupt;
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (pindex == pindexQueued) {
+                pindexQueued = nullptr;
+            }
+            while (pindex == pindexBusy) {
+                cond.wait(lock);
+            }
+            if (pindex != pindexDone) {
+                return nullptr;
+            }
+            pindexDone = nullptr;
+            pblock = std::move(pblockDone);
+            vOutpoints.swap(vOutpointsDone);
+            vCoins.swap(vCoinsDone);
+            hashCoins = hashCoinsDone;
+        }
+        // The UTXO set is a function of the best block, so coins read at the
+        // database's current best block are still what pcoinsTip would read
+        // for any outpoint it has not cached. Flushes run under cs_main and
+        // change the best block, or leave it null while they are partial.
+        if (!hashCoins.IsNull() && hashCoins == pcoinsdbview->GetBestBlock()) {
+            pcoinsTip->CacheCoins(vOutpoints, vCoins);
+        }
+        return pblock;
+    }
+
+    void Thread()
+    {
+        while (true) {
+            const CBlockIndex* pindex;
+            CDiskBlockPos pos;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while (pindexQueued == nullptr) {
+                    cond.wait(lock);
+                }
+                pindex = pindexBusy = pindexQueued;
+                pos = posQueued;
+                pindexQueued = nullptr;
+                pindexDone = nullptr;
+                pblockDone.reset();
+            }
+            const int64_t nTimeStart = GetTimeMicros();
+            std::vector<COutPoint> vOutpoints;
+            std::vector<Coin> vCoins;
+            uint256 hashCoins;
+            std::shared_ptr<const CBlock> pblock = Prefetch(pindex, pos, vOutpoints, vCoins, hashCoins);
+            LogPrint(BCLog::BENCH, "  - Prefetch block %d: %u inputs, %.2fms\n", pindex->nHeight, vOutpoints.size(), (GetTimeMicros() - nTimeStart) * MILLI);
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                pindexBusy = nullptr;
+                if (pblock) {
+                    pindexDone = pindex;
+                    pblockDone = std::move(pblock);
+                    vOutpointsDone.swap(vOutpoints);
+                    vCoinsDone.swap(vCoins);
+                    hashCoinsDone = hashCoins;
+                }
+                cond.notify_all();
+            }
+        }
+    }
+};
+
+CBlockPrefetcher blockPrefetcher;
+
+} // namespace
+
+void ThreadBlockPrefetch() {
+    RenameThread("kevacoin-prefetch");
+    blockPrefetcher.Thread();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1859,8 +2190,13 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // GetAdjustedTime() to go backward).
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck))
+    // Ancestors of the -assumevalidpow block skip the PoW check; for anything
+    // else it also settles a check deferred when the header was accepted.
+    const bool fCheckPoW = !fJustCheck && !IsPoWAssumedValid(pindex);
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), fCheckPoW, !fJustCheck))
         return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
+    if (fCheckPoW)
+        ClearPoWAssumed(pindex);
 
     // verify that the view's current state corresponds to the previous block
     uint256 hashPrevBlock = pindex->pprev == nullptr ? uint256() : pindex->pprev->GetBlockHash();
@@ -1965,8 +2301,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int nInputs = 0;
     int64_t nSigOpsCost = 0;
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<PrecomputedTransactionData> txdata;
-    txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
+    // Held until the script checks are done, as they point into it
+    std::vector<std::shared_ptr<const PrecomputedTransactionData>> txdata;
+    txdata.reserve(block.vtx.size());
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
@@ -2008,12 +2345,20 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             return state.DoS(100, error("ConnectBlock(): too many sigops"),
                              REJECT_INVALID, "bad-blk-sigops");
 
-        txdata.emplace_back(tx);
         if (!tx.IsCoinBase())
         {
+            // Reuse what was computed when the tx entered the mempool. The
+            // txid commits to everything but the witness, and that is all
+            // the precomputed data covers.
+            std::shared_ptr<const PrecomputedTransactionData> ptxdata = mempool.GetPrecomputedData(tx.GetHash());
+            if (!ptxdata) {
+                ptxdata = std::make_shared<PrecomputedTransactionData>(tx);
+            }
+            txdata.push_back(ptxdata);
+
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
+            if (!CheckInputs(tx, state, view, fScriptChecks, flags, fCacheResults, fCacheResults, *ptxdata, nScriptCheckThreads ? &vChecks : nullptr))
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             control.Add(vChecks);
@@ -2311,6 +2656,10 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     }
 
     chainActive.SetTip(pindexDelete->pprev);
+    // Undo the seed height entry ConnectTip set for this block
+    if (crypto::is_a_seed_height(pindexDelete->nHeight) && seedHeightIndex.Get(pindexDelete->nHeight) == pindexDelete) {
+        seedHeightIndex.Set(pindexDelete->nHeight, FindSeedBlockFallback(mapBlockIndex, pindexBestHeader, pindexDelete));
+    }
 
     UpdateTip(pindexDelete->pprev, chainparams);
     CheckNameDB(true);
@@ -2404,12 +2753,15 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
+        pthisBlock = blockPrefetcher.Get(pindexNew);
+    } else {
+        pthisBlock = pblock;
+    }
+    if (!pthisBlock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
             return AbortNode(state, "Failed to read block");
         pthisBlock = pblockNew;
-    } else {
-        pthisBlock = pblock;
     }
     const CBlock& blockConnecting = *pthisBlock;
     // Apply the block atomically to the chain state.
@@ -2442,6 +2794,9 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update chainActive & related variables.
     chainActive.SetTip(pindexNew);
+    if (crypto::is_a_seed_height(pindexNew->nHeight)) {
+        seedHeightIndex.Set(pindexNew->nHeight, pindexNew);
+    }
     UpdateTip(pindexNew, chainparams);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
@@ -2565,6 +2920,10 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
 
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
+            // Have the next block read while this one is connected.
+            if (fBlockPrefetch && pindexConnect != pindexMostWork) {
+                blockPrefetcher.Request(pindexMostWork->GetAncestor(pindexConnect->nHeight + 1));
+            }
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
@@ -2882,12 +3241,12 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
     pindexNew->nSequenceId = 0;
+    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
+    pindexNew->phashBlock = &((*mi).first);
     uint64_t height = block.nNonce;
     if (crypto::is_a_seed_height(height)) {
-        mapBlockSeedHeight.insert(std::make_pair(height, pindexNew));
+        seedHeightIndex.Add(height, pindexNew);
     }
-    BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
-    pindexNew->phashBlock = &((*mi).first);
     BlockMap::iterator miPrev = mapBlockIndex.find(block.hashPrevBlock);
     if (miPrev != mapBlockIndex.end())
     {
@@ -3043,7 +3402,7 @@ static bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos,
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const uint256* pPoWHash = nullptr)
 {
     uint32_t height = block.nNonce;
     if (block.cnHeader.major_version != consensusParams.GetCryptonoteMajorVersion(height)) {
@@ -3051,7 +3410,7 @@ static bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state,
     }
 
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(pPoWHash ? *pPoWHash : block.GetPoWHash(), block.nBits, consensusParams))
         return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
 
     return true;
@@ -3069,6 +3428,24 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
     if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
         return false;
 
+    // The transaction checks do not depend on anything checked before them,
+    // so large blocks hand them to the block check threads right away and
+    // compute the merkle root on this thread meanwhile. Their results are
+    // only looked at where the checks used to run.
+    // vSigOps is declared first so that it outlives control, whose
+    // destructor waits for the checks still writing to it on early returns.
+    const bool fParallel = nBlockCheckThreads && block.vtx.size() >= MIN_PARALLEL_CHECK_TXS;
+    std::vector<unsigned int> vSigOps;
+    CCheckQueueControl<CBlockTxCheck> control(fParallel ? &blockcheckqueue : nullptr);
+    if (fParallel) {
+        vSigOps.resize(block.vtx.size());
+        std::vector<CBlockTxCheck> vChecks;
+        vChecks.reserve(block.vtx.size());
+        for (size_t i = 0; i < block.vtx.size(); i++)
+            vChecks.emplace_back(*block.vtx[i], &vSigOps[i]);
+        control.Add(vChecks);
+    }
+
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -3100,16 +3477,26 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         if (block.vtx[i]->IsCoinBase())
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
 
-    // Check transactions
-    for (const auto& tx : block.vtx)
-        if (!CheckTransaction(*tx, state, true))
-            return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+    // Check transactions. If a threaded check failed, find the first failing
+    // transaction again to report its error. Should none fail this time, the
+    // sigops are counted here as well.
+    const bool fParallelChecked = fParallel && control.Wait();
+    if (!fParallelChecked) {
+        for (const auto& tx : block.vtx)
+            if (!CheckTransaction(*tx, state, true))
+                return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(),
+                                     strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+    }
 
     unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
-    {
-        nSigOps += GetLegacySigOpCount(*tx);
+    if (fParallelChecked) {
+        for (unsigned int nTxSigOps : vSigOps)
+            nSigOps += nTxSigOps;
+    } else {
+        for (const auto& tx : block.vtx)
+        {
+            nSigOps += GetLegacySigOpCount(*tx);
+        }
     }
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.DoS(100, false, REJECT_INVALID, "bad-blk-sigops", false, "out-of-bounds SigOpCount");
@@ -3331,13 +3718,14 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pPoWHash, bool fMayDeferPoW)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
+    bool fPoWDeferred = false;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
 
         if (miSelf != mapBlockIndex.end()) {
@@ -3350,7 +3738,9 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        // The PoW is checked last: hashing a header costs far more than
+        // any of the other checks.
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), false))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3378,9 +3768,26 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
                 }
             }
         }
+
+        // A header whose PoW is deferred must at least commit to its own
+        // hash, or it would be indexed under the all-ones GetHash() gives
+        // an inconsistent one.
+        fPoWDeferred = fMayDeferPoW && IsPoWDeferred(pindexPrev, chainparams);
+        if (fPoWDeferred && !block.isCNConsistent())
+            return state.DoS(100, error("%s: Cryptonote header does not commit to block %s", __func__, block.GetOriginalBlockHash().ToString()), REJECT_INVALID, "bad-cn-previd");
+        if (!fPoWDeferred && !CheckBlockHeader(block, state, chainparams.GetConsensus(), true, pPoWHash))
+            return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
     }
-    if (pindex == nullptr)
+    if (pindex == nullptr) {
         pindex = AddToBlockIndex(block);
+        if (fPoWDeferred) {
+            pindex->nStatus |= BLOCK_POW_ASSUMED;
+            setPoWAssumedBlockIndex.insert(pindex);
+            setDirtyBlockIndex.insert(pindex);
+        }
+        if (hash == hashAssumeValidPoW && nAssumeValidPoWHeight >= 0)
+            ResolveAssumedPoW(pindex);
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -3391,14 +3798,42 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
 }
 
 // Exposed wrapper for AcceptBlockHeader
-bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
+bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid, bool fMayDeferPoW)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+
+        // Evaluate the PoW of the new headers in one batch, so that RandomX
+        // headers sharing a seed are hashed back-to-back. All checks are left
+        // to AcceptBlockHeader, which hashes whatever is missing from the
+        // batch by itself. Headers that do not connect are not batched, nor
+        // those up to an unknown -assumevalidpow checkpoint, whose PoW check
+        // is likely to be deferred.
+        const bool fDeferring = fMayDeferPoW && nAssumeValidPoWHeight >= 0 && !mapBlockIndex.count(hashAssumeValidPoW);
+        std::vector<const CBlockHeader*> vNewHeaders;
+        std::vector<size_t> vNewIndex;
+        if (!headers.empty() && mapBlockIndex.count(headers[0].hashPrevBlock)) {
+            for (size_t i = 0; i < headers.size(); i++) {
+                const CBlockHeader& header = headers[i];
+                if ((fDeferring && (int64_t)header.nNonce <= nAssumeValidPoWHeight) || mapBlockIndex.count(header.GetHash()))
+                    continue;
+                vNewHeaders.push_back(&header);
+                vNewIndex.push_back(i);
+            }
+        }
+        std::vector<uint256> vNewPoWHashes;
+        GetPoWHashes(vNewHeaders, vNewPoWHashes);
+        std::vector<uint256> vPoWHashes(headers.size());
+        for (size_t i = 0; i < vNewIndex.size(); i++) {
+            vPoWHashes[vNewIndex[i]] = vNewPoWHashes[i];
+        }
+
+        for (size_t i = 0; i < headers.size(); i++) {
+            const CBlockHeader& header = headers[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            const uint256* pPoWHash = vPoWHashes[i].IsNull() ? nullptr : &vPoWHashes[i];
+            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, pPoWHash, fMayDeferPoW)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
@@ -3477,7 +3912,10 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
     }
     if (fNewBlock) *fNewBlock = true;
 
-    if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
+    // A PoW deferred with the header is settled here at the latest, so that
+    // no block data is stored without it.
+    const bool fCheckPoW = !IsPoWAssumedValid(pindex);
+    if (!CheckBlock(block, state, chainparams.GetConsensus(), fCheckPoW) ||
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3485,6 +3923,8 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         }
         return error("%s: %s", __func__, FormatStateMessage(state));
     }
+    if (fCheckPoW)
+        ClearPoWAssumed(pindex);
 
     // Header is valid/has work, merkle tree and segwit merkle tree are good...RELAY NOW
     // (but if it does not build on our best tip, let the SendMessages loop relay it)
@@ -3522,7 +3962,14 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         CValidationState state;
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
-        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        bool fCheckPoW = true;
+        if (!hashAssumeValidPoW.IsNull()) {
+            LOCK(cs_main);
+            BlockMap::const_iterator it = mapBlockIndex.find(pblock->GetHash());
+            if (it != mapBlockIndex.end())
+                fCheckPoW = !IsPoWAssumedValid(it->second);
+        }
+        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus(), fCheckPoW);
 
         LOCK(cs_main);
 
@@ -3785,11 +4232,11 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash, int nHeight)
         nHeight = 0;
     }
     pindexNew->nNonce = nHeight;
-    if (crypto::is_a_seed_height(nHeight)) {
-        mapBlockSeedHeight.insert(std::make_pair(nHeight, pindexNew));
-    }
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
+    if (crypto::is_a_seed_height(nHeight)) {
+        seedHeightIndex.Add(nHeight, pindexNew);
+    }
 
     return pindexNew;
 }
@@ -3841,6 +4288,16 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
             pindex->BuildSkip();
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == nullptr || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
+        if (pindex->nStatus & BLOCK_POW_ASSUMED)
+            setPoWAssumedBlockIndex.insert(pindex);
+    }
+
+    // The -assumevalidpow checkpoint may have arrived without the headers it
+    // settles being flushed, or the option may have been set since.
+    if (nAssumeValidPoWHeight >= 0) {
+        BlockMap::iterator it = mapBlockIndex.find(hashAssumeValidPoW);
+        if (it != mapBlockIndex.end())
+            ResolveAssumedPoW(it->second);
     }
 
     return true;
@@ -3903,6 +4360,20 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     return true;
 }
 
+CBlockIndex* FindSeedBlockFallback(const BlockMap& blockIndex, CBlockIndex* pindexBest, CBlockIndex* pindex)
+{
+    if (pindexBest && pindexBest->nHeight >= pindex->nHeight) {
+        CBlockIndex* pindexSeed = pindexBest->GetAncestor(pindex->nHeight);
+        if (pindexSeed != pindex && !(pindexSeed->nStatus & BLOCK_FAILED_MASK))
+            return pindexSeed;
+    }
+    for (const std::pair<const uint256, CBlockIndex*>& item : blockIndex) {
+        if (item.second->nHeight == pindex->nHeight && item.second != pindex && !(item.second->nStatus & BLOCK_FAILED_MASK))
+            return item.second;
+    }
+    return (pindex->nStatus & BLOCK_FAILED_MASK) ? nullptr : pindex;
+}
+
 bool LoadChainTip(const CChainParams& chainparams)
 {
     if (chainActive.Tip() && chainActive.Tip()->GetBlockHash() == pcoinsTip->GetBestBlock()) return true;
@@ -3923,6 +4394,12 @@ bool LoadChainTip(const CChainParams& chainparams)
         return false;
     chainActive.SetTip(it->second);
 
+    // Seed blocks on the active chain take precedence over stale ones that
+    // happened to be loaded first.
+    for (int nSeedHeight = 0; nSeedHeight <= chainActive.Height(); nSeedHeight += CSeedHeightIndex::EPOCH_BLOCKS) {
+        seedHeightIndex.Set(nSeedHeight, chainActive[nSeedHeight]);
+    }
+
     g_chainstate.PruneBlockIndexCandidates();
 
     LogPrintf("Loaded best chain: hashBestChain=%s height=%d date=%s progress=%f\n",
@@ -4250,6 +4727,7 @@ void UnloadBlockIndex()
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
+    setPoWAssumedBlockIndex.clear();
     setDirtyFileInfo.clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
@@ -4260,7 +4738,7 @@ void UnloadBlockIndex()
         delete entry.second;
     }
     mapBlockIndex.clear();
-    mapBlockSeedHeight.clear();
+    seedHeightIndex.Clear();
     fHavePruned = false;
 
     g_chainstate.UnloadBlockIndex();
@@ -4809,6 +5287,6 @@ public:
         for (; it1 != mapBlockIndex.end(); it1++)
             delete (*it1).second;
         mapBlockIndex.clear();
-        mapBlockSeedHeight.clear();
+        seedHeightIndex.Clear();
     }
 } instance_of_cmaincleanup;
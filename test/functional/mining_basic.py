@@ -5,6 +5,7 @@
 """Test mining RPCs
 
 - getmininginfo
+- getpowinfo
 - getblocktemplate proposal mode
 - submitblock"""
 
@@ -52,6 +53,13 @@ class MiningTest(BitcoinTestFramework):
         assert_equal(mining_info['networkhashps'], Decimal('0.003333333333333334'))
         assert_equal(mining_info['pooledtx'], 0)
 
+        self.log.info('getpowinfo')
+        pow_info = node.getpowinfo()
+        assert pow_info['algorithm'] in ('randomx', 'cryptonight variant %d' % (pow_info['major_version'] - 6))
+        assert pow_info['cryptonight']['implementation']
+        assert pow_info['cryptonight']['hardware_aes'] <= pow_info['cryptonight']['cpu_aes']
+        assert pow_info['randomx']['argon2'] in ('avx2', 'ssse3', 'ref')
+
         # Mine a block to leave initial block download
         node.generate(1)
         tmpl = node.getblocktemplate()
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018 The Kevacoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the Cryptonote job server (-cnjobport).
+
+- login returns the same job as getblocktemplate
+- a new job is pushed when the tip changes
+- bad submissions and unknown methods are answered with errors"""
+
+import json
+import socket
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, connect_nodes, p2p_port
+
+class JobClient():
+    def __init__(self, port):
+        self.sock = socket.create_connection(('127.0.0.1', port), timeout=60)
+        self.buf = b''
+        self.next_id = 0
+
+    def send(self, method, params):
+        self.next_id += 1
+        msg = {'id': self.next_id, 'method': method, 'params': params}
+        self.sock.sendall((json.dumps(msg) + '\n').encode('utf-8'))
+        return self.next_id
+
+    def recv(self):
+        while b'\n' not in self.buf:
+            data = self.sock.recv(65536)
+            assert data, 'connection closed'
+            self.buf += data
+        line, self.buf = self.buf.split(b'\n', 1)
+        return json.loads(line.decode('utf-8'))
+
+    def call(self, method, params):
+        request_id = self.send(method, params)
+        reply = self.recv()
+        assert_equal(reply['id'], request_id)
+        return reply
+
+class CNJobServerTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+
+    def setup_network(self):
+        self.job_port = p2p_port(self.num_nodes)
+        self.extra_args = [['-cnjobport=%d' % self.job_port], []]
+        self.setup_nodes()
+        connect_nodes(self.nodes[0], 1)
+        self.sync_all()
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(1)
+        self.sync_all()
+        address = node.getnewaddress()
+
+        client = JobClient(self.job_port)
+
+        self.log.info("Login without parameters fails")
+        reply = client.call('login', [])
+        assert reply['error'] is not None
+
+        self.log.info("Login returns the current job")
+        reply = client.call('login', {'wallet_address': address, 'reserve_size': 8})
+        assert_equal(reply['error'], None)
+        job = reply['result']
+        assert_equal(job['height'], node.getblockcount() + 1)
+        assert_equal(job['longpollid'], node.getblocktemplate(8, address)['longpollid'])
+        assert 'blocktemplate_blob' in job
+        assert 'target' in job
+
+        self.log.info("A new tip pushes a new job")
+        self.nodes[1].generate(1)
+        self.sync_all()
+        notification = client.recv()
+        assert_equal(notification['method'], 'job')
+        assert_equal(notification['params']['height'], node.getblockcount() + 1)
+        assert notification['params']['longpollid'] != job['longpollid']
+
+        self.log.info("Invalid submissions are rejected")
+        reply = client.call('submit', {'blob': '00'})
+        assert reply['error'] is not None
+        reply = client.call('submit', [])
+        assert reply['error'] is not None
+
+        self.log.info("Unknown methods are rejected")
+        reply = client.call('getwork', {})
+        assert_equal(reply['error']['code'], -32601)
+
+if __name__ == '__main__':
+    CNJobServerTest().main()
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018 The Kevacoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the signature cache RPCs getsigcacheinfo and setsigcachesize.
+
+- accepting a tx into the mempool stores its signatures
+- connecting the block that contains it hits the cache
+- resizing keeps the counters and changes the capacity"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class SigCacheTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [['-maxsigcachesize=8']]
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("The cache is sized from -maxsigcachesize")
+        info = node.getsigcacheinfo()
+        assert_equal(info['bytes'], 4 << 20)
+        assert_equal(info['elements'] * 32, info['bytes'])
+
+        self.log.info("Mempool acceptance stores signatures, the block hits them")
+        node.sendtoaddress(node.getnewaddress(), 1)
+        after_accept = node.getsigcacheinfo()
+        assert after_accept['inserts'] > info['inserts']
+        assert after_accept['misses'] > info['misses']
+        node.generate(1)
+        after_block = node.getsigcacheinfo()
+        assert after_block['hits'] > after_accept['hits']
+
+        self.log.info("Resizing changes the capacity and keeps the counters")
+        resized = node.setsigcachesize(16)
+        assert_equal(resized['bytes'], 16 << 20)
+        assert_equal(resized['hits'], after_block['hits'])
+        assert_equal(resized['evictions'], after_block['evictions'])
+        assert_equal(node.getsigcacheinfo()['elements'], resized['elements'])
+
+        assert_raises_rpc_error(-8, "size must be between", node.setsigcachesize, -1)
+
+if __name__ == '__main__':
+    SigCacheTest().main()
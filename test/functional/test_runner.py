@@ -120,6 +120,7 @@ BASE_SCRIPTS= [
     'feature_nulldummy.py',
     'wallet_import_rescan.py',
     'mining_basic.py',
+    'mining_cn_jobserver.py',
     'wallet_bumpfee.py',
     'rpc_named_arguments.py',
     'wallet_listsinceblock.py',
@@ -129,6 +130,7 @@ BASE_SCRIPTS= [
     'feature_dersig.py',
     'feature_cltv.py',
     'rpc_uptime.py',
+    'rpc_sigcache.py',
     'wallet_resendwallettransactions.py',
     'feature_minchainwork.py',
     'p2p_fingerprint.py',